@@ -0,0 +1,52 @@
+#ifndef ASYNCDATABASE_HPP
+#define ASYNCDATABASE_HPP
+
+#include <future>
+#include <string>
+#include <vector>
+
+#include "Database.hpp"
+#include "ThreadPool.hpp"
+
+// 异步版本的 Database 接口: 查询立即返回 future, 调用方可以同时发出很多请求
+class AsyncDatabase {
+public:
+	virtual ~AsyncDatabase() = default;
+	virtual std::future<int> get_population_async(const std::string& name) = 0;
+};
+
+// 把任意同步 Database 适配成 AsyncDatabase, 查询在线程池上执行
+class ExecutorDatabase final : public AsyncDatabase {
+private:
+	Database& db_;
+	ThreadPool& pool_;
+
+public:
+	ExecutorDatabase(Database& db, ThreadPool& pool) : db_{db}, pool_{pool} {}
+
+	std::future<int> get_population_async(const std::string& name) override {
+		return pool_.submit([this, name] { return db_.get_population(name); });
+	}
+};
+
+// 先把所有查询都发出去, 再依次收集结果求和; 总耗时约等于最慢的那一批, 而不是所有往返之和
+struct AsyncRecordFinder {
+public:
+	AsyncDatabase& db;
+
+	explicit AsyncRecordFinder(AsyncDatabase& db) : db{db} {}
+
+	[[nodiscard]] int total_population(const std::vector<std::string>& names) const {
+		std::vector<std::future<int>> populations;
+		populations.reserve(names.size());
+		for (auto& name : names)
+			populations.push_back(db.get_population_async(name));
+
+		int result = 0;
+		for (auto& population : populations)
+			result += population.get();
+		return result;
+	}
+};
+
+#endif //ASYNCDATABASE_HPP
@@ -0,0 +1,108 @@
+#ifndef CACHINGDATABASE_HPP
+#define CACHINGDATABASE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "Database.hpp"
+
+// 读穿透的 LRU 缓存装饰器, 可以包在任意 Database 外面.
+// 按 key 的哈希分成若干分片, 每个分片一把锁一条 LRU 链表, 多线程查询不会全部挤在一把锁上;
+// 访问慢速后端时不持有锁
+class CachingDatabase final : public Database {
+public:
+	struct Stats {
+		std::uint64_t hits;
+		std::uint64_t misses;
+		std::uint64_t evictions;
+	};
+
+private:
+	struct Entry {
+		std::string name;
+		int population;
+	};
+
+	struct alignas(64) Shard {
+		std::mutex mutex;
+		std::list<Entry> lru; // 表头是最近使用的
+		std::unordered_map<std::string_view, std::list<Entry>::iterator> index; // key 指向链表节点里的 name
+		std::uint64_t hits{0};
+		std::uint64_t misses{0};
+		std::uint64_t evictions{0};
+		std::size_t capacity{0};
+	};
+
+	Database& backing_;
+	bool cache_negative_;
+	std::size_t shard_count_;
+	std::unique_ptr<Shard[]> shards_;
+
+	Shard& shard_for(const std::string_view name) const {
+		return shards_[std::hash<std::string_view>{}(name) % shard_count_];
+	}
+
+public:
+	// capacity 是总条目数, 分给各个分片, 余数给前几个分片, 总和恰好是 capacity;
+	// 分片数不超过 capacity, 每个分片至少能放一条. capacity 为 0 时不缓存.
+	// cache_negative 为 true 时连后端查不到(返回 0)的名字也缓存起来
+	explicit CachingDatabase(Database& backing, const std::size_t capacity,
+	                         const bool cache_negative = true, const std::size_t shard_count = 16)
+		: backing_{backing},
+		  cache_negative_{cache_negative},
+		  shard_count_{std::max<std::size_t>(1, std::min(shard_count, capacity))},
+		  shards_{std::make_unique<Shard[]>(shard_count_)} {
+		for (std::size_t i = 0; i < shard_count_; ++i)
+			shards_[i].capacity = capacity / shard_count_ + (i < capacity % shard_count_ ? 1 : 0);
+	}
+
+	int get_population(const std::string& name) override {
+		Shard& shard = shard_for(name);
+		{
+			std::lock_guard<std::mutex> lock{shard.mutex};
+			if (const auto it = shard.index.find(name); it != shard.index.end()) {
+				shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+				++shard.hits;
+				return it->second->population;
+			}
+			++shard.misses;
+		}
+
+		const int population = backing_.get_population(name);
+		if ((population == 0 && !cache_negative_) || shard.capacity == 0)
+			return population;
+
+		std::lock_guard<std::mutex> lock{shard.mutex};
+		if (shard.index.find(name) != shard.index.end())
+			return population; // 别的线程已经填好了
+
+		shard.lru.push_front(Entry{name, population});
+		shard.index.emplace(shard.lru.front().name, shard.lru.begin());
+		if (shard.lru.size() > shard.capacity) {
+			shard.index.erase(shard.lru.back().name);
+			shard.lru.pop_back();
+			++shard.evictions;
+		}
+		return population;
+	}
+
+	[[nodiscard]] Stats stats() const {
+		Stats total{0, 0, 0};
+		for (std::size_t i = 0; i < shard_count_; ++i) {
+			std::lock_guard<std::mutex> lock{shards_[i].mutex};
+			total.hits += shards_[i].hits;
+			total.misses += shards_[i].misses;
+			total.evictions += shards_[i].evictions;
+		}
+		return total;
+	}
+};
+
+#endif //CACHINGDATABASE_HPP
@@ -0,0 +1,344 @@
+#ifndef CAPITALSINDEX_HPP
+#define CAPITALSINDEX_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 预先构建好的人口索引文件, 按主机字节序直接映射进内存, 不做任何解析:
+//
+// [Header][seeds: uint32 * bucket_count][slots: uint32 * slot_count][entries: Entry * count][strings]
+//
+// entries 按名字排序(有序字符串表), seeds + slots 组成完美哈希目录(hash and displace):
+// bucket = hash(name, 0) % bucket_count
+// slot   = hash(name, seeds[bucket]) % slot_count
+// slots[slot] 即 entries 的下标
+namespace capitals_index {
+
+constexpr std::uint32_t magic = 0x58444943; // "CIDX"
+constexpr std::uint32_t version = 1;
+constexpr std::uint32_t empty_slot = 0xFFFFFFFFu;
+
+struct Header {
+	std::uint32_t magic;
+	std::uint32_t version;
+	std::uint32_t count;
+	std::uint32_t bucket_count;
+	std::uint32_t slot_count;
+	std::uint32_t reserved;
+	std::uint64_t seeds_offset;
+	std::uint64_t slots_offset;
+	std::uint64_t entries_offset;
+	std::uint64_t strings_offset;
+	std::uint64_t file_size;
+};
+
+struct Entry {
+	std::uint32_t name_offset;
+	std::uint32_t name_length;
+	std::int32_t population;
+	std::uint32_t reserved;
+};
+
+// 带种子的 FNV-1a, 末尾用 splitmix64 打散低位
+inline std::uint64_t hash(const std::string_view key, const std::uint64_t seed) {
+	std::uint64_t h = 0xcbf29ce484222325ull ^ (seed * 0x9E3779B97F4A7C15ull);
+	for (const unsigned char c : key) {
+		h ^= c;
+		h *= 0x100000001b3ull;
+	}
+	h ^= h >> 30;
+	h *= 0xbf58476d1ce4e5b9ull;
+	h ^= h >> 27;
+	h *= 0x94d049bb133111ebull;
+	h ^= h >> 31;
+	return h;
+}
+
+inline std::uint64_t align8(const std::uint64_t offset) {
+	return (offset + 7) & ~std::uint64_t{7};
+}
+
+// 解析书中的文本格式: 一行城市名, 一行人口, 交替出现; 重复的名字以后出现的为准
+inline std::map<std::string, int> parse_capitals(const std::string& path) {
+	std::ifstream ifs(path);
+	if (!ifs)
+		throw std::runtime_error("Cannot open " + path);
+
+	std::map<std::string, int> capitals;
+	std::string name, population;
+	while (std::getline(ifs, name) && std::getline(ifs, population)) {
+		if (!name.empty() && name.back() == '\r')
+			name.pop_back();
+		if (name.empty())
+			continue;
+		capitals[name] = std::stoi(population);
+	}
+	return capitals;
+}
+
+// 把 (有序的) 城市表写成索引文件
+inline void build_index(const std::map<std::string, int>& capitals, const std::string& path) {
+	const auto count = static_cast<std::uint32_t>(capitals.size());
+
+	std::vector<std::string_view> names;
+	std::vector<Entry> entries;
+	std::string strings;
+	names.reserve(count);
+	entries.reserve(count);
+	for (auto&& [name, population] : capitals) {
+		entries.push_back(Entry{
+			static_cast<std::uint32_t>(strings.size()),
+			static_cast<std::uint32_t>(name.size()),
+			population, 0});
+		strings += name;
+		names.emplace_back(name);
+	}
+
+	// 每个桶平均 4 个 key, 负载因子 0.8; 找不到合适的种子就放大槽位重来
+	const std::uint32_t bucket_count = std::max<std::uint32_t>(1, (count + 3) / 4);
+	std::uint32_t slot_count = std::max<std::uint32_t>(1, count + count / 4);
+	std::vector<std::uint32_t> seeds;
+	std::vector<std::uint32_t> slots;
+
+	std::vector<std::vector<std::uint32_t>> buckets(bucket_count);
+	for (std::uint32_t i = 0; i < count; ++i)
+		buckets[hash(names[i], 0) % bucket_count].push_back(i);
+
+	std::vector<std::uint32_t> order(bucket_count);
+	for (std::uint32_t b = 0; b < bucket_count; ++b)
+		order[b] = b;
+	std::stable_sort(order.begin(), order.end(), [&](const std::uint32_t l, const std::uint32_t r) {
+		return buckets[l].size() > buckets[r].size();
+	});
+
+	for (bool placed = false; !placed; slot_count += slot_count / 10 + 1) {
+		seeds.assign(bucket_count, 0);
+		slots.assign(slot_count, empty_slot);
+		placed = true;
+
+		std::vector<std::uint32_t> candidate;
+		for (const std::uint32_t b : order) {
+			const auto& bucket = buckets[b];
+			if (bucket.empty())
+				break;
+
+			bool found = false;
+			for (std::uint32_t seed = 1; seed < (1u << 16) && !found; ++seed) {
+				candidate.clear();
+				found = true;
+				for (const std::uint32_t i : bucket) {
+					const auto slot = static_cast<std::uint32_t>(hash(names[i], seed) % slot_count);
+					if (slots[slot] != empty_slot ||
+						std::find(candidate.begin(), candidate.end(), slot) != candidate.end()) {
+						found = false;
+						break;
+					}
+					candidate.push_back(slot);
+				}
+				if (found) {
+					seeds[b] = seed;
+					for (std::size_t k = 0; k < bucket.size(); ++k)
+						slots[candidate[k]] = bucket[k];
+				}
+			}
+			if (!found) {
+				placed = false;
+				break;
+			}
+		}
+		if (placed)
+			break;
+	}
+
+	Header header{};
+	header.magic = magic;
+	header.version = version;
+	header.count = count;
+	header.bucket_count = bucket_count;
+	header.slot_count = slot_count;
+	header.seeds_offset = align8(sizeof(Header));
+	header.slots_offset = align8(header.seeds_offset + bucket_count * sizeof(std::uint32_t));
+	header.entries_offset = align8(header.slots_offset + slot_count * sizeof(std::uint32_t));
+	header.strings_offset = header.entries_offset + count * sizeof(Entry);
+	header.file_size = header.strings_offset + strings.size();
+
+	std::vector<char> image(header.file_size, 0);
+	std::memcpy(image.data(), &header, sizeof(Header));
+	std::memcpy(image.data() + header.seeds_offset, seeds.data(), seeds.size() * sizeof(std::uint32_t));
+	std::memcpy(image.data() + header.slots_offset, slots.data(), slots.size() * sizeof(std::uint32_t));
+	std::memcpy(image.data() + header.entries_offset, entries.data(), entries.size() * sizeof(Entry));
+	std::memcpy(image.data() + header.strings_offset, strings.data(), strings.size());
+
+	// 先写临时文件再 rename: 已经映射着旧文件的进程继续看到旧内容, 不会读到写了一半的索引
+	const std::string temporary = path + ".tmp";
+	{
+		std::ofstream ofs(temporary, std::ios::binary | std::ios::trunc);
+		if (!ofs.write(image.data(), static_cast<std::streamsize>(image.size())))
+			throw std::runtime_error("Cannot write " + temporary);
+	}
+	if (std::rename(temporary.c_str(), path.c_str()) != 0)
+		throw std::runtime_error("Cannot replace " + path);
+}
+
+// 只读映射索引文件: 启动只有 mmap 的开销, 数据页按需缺页载入,
+// 并且经由 page cache 在多个进程间共享
+class MappedCapitals {
+private:
+	const char* data_{nullptr};
+	std::size_t size_{0};
+	const Header* header_{nullptr};
+	const std::uint32_t* seeds_{nullptr};
+	const std::uint32_t* slots_{nullptr};
+	const Entry* entries_{nullptr};
+	const char* strings_{nullptr};
+
+	void unmap() {
+		if (data_)
+			::munmap(const_cast<char*>(data_), size_);
+		data_ = nullptr;
+		size_ = 0;
+	}
+
+public:
+	explicit MappedCapitals(const std::string& path) {
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw std::runtime_error("Cannot open " + path);
+
+		struct stat st{};
+		if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(Header)) {
+			::close(fd);
+			throw std::runtime_error("Bad capitals index " + path);
+		}
+
+		size_ = static_cast<std::size_t>(st.st_size);
+		void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (mapped == MAP_FAILED)
+			throw std::runtime_error("Cannot mmap " + path);
+		data_ = static_cast<const char*>(mapped);
+
+		header_ = reinterpret_cast<const Header*>(data_);
+		const auto& h = *header_;
+		const bool valid = h.magic == magic && h.version == version &&
+			h.file_size <= size_ && h.bucket_count > 0 && h.slot_count > 0 &&
+			h.seeds_offset + std::uint64_t{h.bucket_count} * sizeof(std::uint32_t) <= h.slots_offset &&
+			h.slots_offset + std::uint64_t{h.slot_count} * sizeof(std::uint32_t) <= h.entries_offset &&
+			h.entries_offset + std::uint64_t{h.count} * sizeof(Entry) <= h.strings_offset &&
+			h.strings_offset <= h.file_size;
+		if (!valid) {
+			unmap();
+			throw std::runtime_error("Bad capitals index " + path);
+		}
+
+		seeds_ = reinterpret_cast<const std::uint32_t*>(data_ + h.seeds_offset);
+		slots_ = reinterpret_cast<const std::uint32_t*>(data_ + h.slots_offset);
+		entries_ = reinterpret_cast<const Entry*>(data_ + h.entries_offset);
+		strings_ = data_ + h.strings_offset;
+
+		// name() / find() / find_batch() 直接按条目里的偏移读字符串区, 这里逐条确认都落在文件之内
+		for (std::uint32_t i = 0; i < h.count; ++i) {
+			const Entry& e = entries_[i];
+			if (h.strings_offset + e.name_offset + e.name_length > h.file_size) {
+				unmap();
+				throw std::runtime_error("Bad capitals index " + path);
+			}
+		}
+	}
+
+	MappedCapitals(const MappedCapitals&) = delete;
+	MappedCapitals& operator=(const MappedCapitals&) = delete;
+
+	MappedCapitals(MappedCapitals&& other) noexcept { *this = std::move(other); }
+	MappedCapitals& operator=(MappedCapitals&& other) noexcept {
+		if (this != &other) {
+			unmap();
+			data_ = std::exchange(other.data_, nullptr);
+			size_ = std::exchange(other.size_, 0);
+			header_ = other.header_;
+			seeds_ = other.seeds_;
+			slots_ = other.slots_;
+			entries_ = other.entries_;
+			strings_ = other.strings_;
+		}
+		return *this;
+	}
+
+	~MappedCapitals() { unmap(); }
+
+	[[nodiscard]] std::size_t size() const { return header_->count; }
+
+	[[nodiscard]] std::string_view name(const std::size_t index) const {
+		const Entry& e = entries_[index];
+		return {strings_ + e.name_offset, e.name_length};
+	}
+
+	[[nodiscard]] int population(const std::size_t index) const {
+		return entries_[index].population;
+	}
+
+	// 找不到时返回 nullptr
+	[[nodiscard]] const std::int32_t* find(const std::string_view key) const {
+		const std::uint32_t bucket = static_cast<std::uint32_t>(hash(key, 0) % header_->bucket_count);
+		const std::uint32_t slot = static_cast<std::uint32_t>(hash(key, seeds_[bucket]) % header_->slot_count);
+		const std::uint32_t index = slots_[slot];
+		if (index == empty_slot || index >= header_->count || name(index) != key)
+			return nullptr;
+		return &entries_[index].population;
+	}
+
+	// 批量查找: 先算出一批 key 的哈希并预取目录, 再逐级解析,
+	// 让各个 key 的 cache miss 互相重叠, 而不是一个接一个地等待
+	void find_batch(const std::string_view* keys, int* populations, const std::size_t count,
+	                const int missing = 0) const {
+		constexpr std::size_t block = 16;
+		std::uint64_t hashes[block];
+		std::uint32_t buckets[block];
+		std::uint32_t indices[block];
+
+		for (std::size_t base = 0; base < count; base += block) {
+			const std::size_t n = std::min(block, count - base);
+			const std::string_view* k = keys + base;
+
+			for (std::size_t i = 0; i < n; ++i) {
+				buckets[i] = static_cast<std::uint32_t>(hash(k[i], 0) % header_->bucket_count);
+				__builtin_prefetch(&seeds_[buckets[i]]);
+			}
+			for (std::size_t i = 0; i < n; ++i) {
+				hashes[i] = hash(k[i], seeds_[buckets[i]]) % header_->slot_count;
+				__builtin_prefetch(&slots_[hashes[i]]);
+			}
+			for (std::size_t i = 0; i < n; ++i) {
+				indices[i] = slots_[hashes[i]];
+				if (indices[i] < header_->count) {
+					__builtin_prefetch(&entries_[indices[i]]);
+					__builtin_prefetch(strings_ + entries_[indices[i]].name_offset);
+				}
+			}
+			for (std::size_t i = 0; i < n; ++i) {
+				const std::uint32_t index = indices[i];
+				populations[base + i] = index < header_->count && name(index) == k[i]
+					? entries_[index].population
+					: missing;
+			}
+		}
+	}
+};
+
+} // namespace capitals_index
+
+#endif //CAPITALSINDEX_HPP
@@ -0,0 +1,19 @@
+#ifndef DATABASE_HPP
+#define DATABASE_HPP
+
+#include <cstddef>
+#include <string>
+
+class Database {
+public:
+	virtual ~Database() = default;
+	virtual int get_population(const std::string& name) = 0;
+
+	// 批量查询, 默认逐个转发给 get_population (直接传引用, 不复制名字), 具体数据库可以覆盖它来减少虚调用并做预取
+	virtual void get_populations(const std::string* names, int* populations, const std::size_t count) {
+		for (std::size_t i = 0; i < count; ++i)
+			populations[i] = get_population(names[i]);
+	}
+};
+
+#endif //DATABASE_HPP
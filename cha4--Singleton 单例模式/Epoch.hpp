@@ -0,0 +1,165 @@
+#ifndef EPOCH_HPP
+#define EPOCH_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// 基于 epoch 的延迟回收 (配合 RCU 式的指针替换使用).
+//
+// 读者进入临界区时把当前全局 epoch 记到自己的槽位里, 离开时清零, 全程只有两次原子写, 从不阻塞;
+// 写者替换指针后把旧对象连同当时的 epoch 一起 retire, 等到所有活跃读者的 epoch 都比它新,
+// 说明没有人还能拿着旧指针, 这时才真正释放.
+//
+// 本身也是个单例: 每个线程的槽位用 thread_local 记录, 整个进程共用一个域.
+// 槽位按块分配, 块串成链表, 只增不减: 线程退出时归还槽位供后来的线程复用, 同时存活的线程多于现有槽位时
+// 无锁地再挂一块, 所以读者在任何线程数下都不会失败
+class EpochDomain {
+public:
+	static constexpr std::size_t slots_per_block = 64;
+
+private:
+	struct alignas(64) Slot {
+		std::atomic<std::uint64_t> epoch{0}; // 0 表示不在临界区
+		std::atomic<bool> in_use{false};
+		unsigned depth{0}; // 只由持有该槽位的线程读写, 支持嵌套的 Guard
+	};
+
+	struct SlotBlock {
+		Slot slots[slots_per_block];
+		std::atomic<SlotBlock*> next{nullptr};
+	};
+
+	struct Retired {
+		std::uint64_t epoch;
+		std::function<void()> deleter;
+	};
+
+	std::atomic<std::uint64_t> global_epoch_{1};
+	SlotBlock slots_; // 第一块; 后续的块永不释放, 遍历中的线程不会读到已释放的内存
+	std::mutex retired_mutex_;
+	std::vector<Retired> retired_;
+
+	EpochDomain() = default;
+
+	// 线程第一次进入临界区时占一个空槽, 线程退出时归还
+	struct Registration {
+		Slot* slot{nullptr};
+
+		~Registration() {
+			if (slot)
+				slot->in_use.store(false, std::memory_order_release);
+		}
+	};
+
+	Slot& local_slot() {
+		thread_local Registration registration;
+		if (!registration.slot)
+			registration.slot = &acquire_slot();
+		return *registration.slot;
+	}
+
+	// 依次尝试各块里的空槽; 全满时在链表末尾挂一块新的, 与其他线程竞争失败就用对方挂上的那块
+	Slot& acquire_slot() {
+		for (SlotBlock* block = &slots_;;) {
+			for (auto& slot : block->slots) {
+				bool expected = false;
+				if (!slot.in_use.load(std::memory_order_relaxed) &&
+				    slot.in_use.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+					return slot;
+			}
+			SlotBlock* next = block->next.load(std::memory_order_acquire);
+			if (!next) {
+				auto fresh = std::make_unique<SlotBlock>();
+				if (block->next.compare_exchange_strong(next, fresh.get(), std::memory_order_acq_rel))
+					next = fresh.release();
+			}
+			block = next;
+		}
+	}
+
+	[[nodiscard]] std::uint64_t min_active_epoch() const {
+		std::uint64_t result = std::numeric_limits<std::uint64_t>::max();
+		for (const SlotBlock* block = &slots_; block; block = block->next.load(std::memory_order_acquire)) {
+			for (auto& slot : block->slots) {
+				const std::uint64_t epoch = slot.epoch.load();
+				if (epoch != 0 && epoch < result)
+					result = epoch;
+			}
+		}
+		return result;
+	}
+
+public:
+	EpochDomain(const EpochDomain&) = delete;
+	EpochDomain& operator=(const EpochDomain&) = delete;
+
+	static EpochDomain& get() {
+		static auto domain = new EpochDomain();
+
+		return *domain;
+	}
+
+	// 读者临界区: 在 Guard 存活期间读到的指针不会被释放
+	class Guard {
+	private:
+		Slot& slot_;
+
+	public:
+		explicit Guard(EpochDomain& domain = EpochDomain::get()) : slot_{domain.local_slot()} {
+			if (slot_.depth++ == 0)
+				slot_.epoch.store(domain.global_epoch_.load());
+		}
+
+		Guard(const Guard&) = delete;
+		Guard& operator=(const Guard&) = delete;
+
+		~Guard() {
+			if (--slot_.depth == 0)
+				slot_.epoch.store(0, std::memory_order_release);
+		}
+	};
+
+	// 旧对象已经从共享指针上摘下, 交给域在安全时释放
+	template <typename T>
+	void retire(const T* object) {
+		const std::uint64_t epoch = global_epoch_.fetch_add(1);
+		{
+			std::lock_guard<std::mutex> lock{retired_mutex_};
+			retired_.push_back(Retired{epoch, [object] { delete object; }});
+		}
+		reclaim();
+	}
+
+	// 释放所有不再可能被读者看到的对象, 由写者调用; 读者从不在这里等待
+	void reclaim() {
+		std::vector<Retired> ready;
+		{
+			std::lock_guard<std::mutex> lock{retired_mutex_};
+			const std::uint64_t min_active = min_active_epoch();
+			auto it = retired_.begin();
+			while (it != retired_.end()) {
+				if (it->epoch < min_active) {
+					ready.push_back(std::move(*it));
+					it = retired_.erase(it);
+				} else {
+					++it;
+				}
+			}
+		}
+		for (auto& retired : ready)
+			retired.deleter();
+	}
+
+	[[nodiscard]] std::size_t pending() {
+		std::lock_guard<std::mutex> lock{retired_mutex_};
+		return retired_.size();
+	}
+};
+
+#endif //EPOCH_HPP
@@ -0,0 +1,17 @@
+#ifndef PERTHREADSINGLETON_HPP
+#define PERTHREADSINGLETON_HPP
+
+// 每个线程一个实例的"单例": 第一次在某个线程里 get() 时构造, 线程退出时析构.
+// 实例之间不共享任何可写状态, 适合放线程私有的缓存, 不会在核之间来回抢缓存行
+template <typename T>
+struct per_thread_singleton {
+	per_thread_singleton() = delete;
+
+	static T& get() {
+		thread_local T instance;
+
+		return instance;
+	}
+};
+
+#endif //PERTHREADSINGLETON_HPP
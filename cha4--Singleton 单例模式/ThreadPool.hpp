@@ -0,0 +1,76 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// 固定线程数的线程池, submit 返回 future; 析构时先执行完队列里剩下的任务再退出
+class ThreadPool {
+private:
+	std::vector<std::thread> workers_;
+	std::queue<std::function<void()>> tasks_;
+	std::mutex mutex_;
+	std::condition_variable ready_;
+	bool stopping_{false};
+
+	void run() {
+		for (;;) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock{mutex_};
+				ready_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+				if (tasks_.empty())
+					return;
+				task = std::move(tasks_.front());
+				tasks_.pop();
+			}
+			task();
+		}
+	}
+
+public:
+	explicit ThreadPool(const std::size_t thread_count = std::thread::hardware_concurrency()) {
+		const std::size_t count = std::max<std::size_t>(1, thread_count);
+		workers_.reserve(count);
+		for (std::size_t i = 0; i < count; ++i)
+			workers_.emplace_back([this] { run(); });
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock{mutex_};
+			stopping_ = true;
+		}
+		ready_.notify_all();
+		for (auto& worker : workers_)
+			worker.join();
+	}
+
+	[[nodiscard]] std::size_t size() const { return workers_.size(); }
+
+	template <typename F>
+	std::future<std::invoke_result_t<F>> submit(F&& f) {
+		// std::function 要求可拷贝, 所以 packaged_task 放在 shared_ptr 里
+		auto task = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(f));
+		auto result = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock{mutex_};
+			tasks_.emplace([task] { (*task)(); });
+		}
+		ready_.notify_one();
+		return result;
+	}
+};
+
+#endif //THREADPOOL_HPP
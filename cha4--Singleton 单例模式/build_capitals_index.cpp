@@ -0,0 +1,20 @@
+#include <iostream>
+
+#include "CapitalsIndex.hpp"
+
+// 把书中的文本格式 capitals.txt 预先编译成 SingletonDatabase 直接 mmap 的索引文件
+// 用法: BuildCapitalsIndex [capitals.txt] [capitals.idx]
+int main(int argc, char* argv[]) {
+	const std::string input = argc > 1 ? argv[1] : "capitals.txt";
+	const std::string output = argc > 2 ? argv[2] : "capitals.idx";
+
+	try {
+		const auto capitals = capitals_index::parse_capitals(input);
+		capitals_index::build_index(capitals, output);
+		std::cout << "Wrote " << capitals.size() << " capitals to " << output << std::endl;
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -1,24 +1,71 @@
+#include <algorithm>
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <string>
 #include <map>
+#include <string_view>
+#include <thread>
 #include <vector>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "AsyncDatabase.hpp"
+#include "CachingDatabase.hpp"
+#include "CapitalsIndex.hpp"
+#include "Database.hpp"
+#include "Epoch.hpp"
+#include "PerThreadSingleton.hpp"
+
 using namespace std;
 
-class Database {
+class SingletonDatabase : public Database {
 public:
-	virtual ~Database() = default;
-	virtual int get_population(const std::string& name) = 0;
-};
+	// 索引文件的位置: 环境变量 CAPITALS_INDEX 优先, 否则是可执行文件所在目录下的 capitals.idx
+	// (构建时由 BuildCapitalsIndex 生成), 与当前工作目录无关
+	static std::string index_path() {
+		if (const char* configured = std::getenv("CAPITALS_INDEX"))
+			return configured;
+		std::error_code ec;
+		const auto executable = std::filesystem::read_symlink("/proc/self/exe", ec);
+		if (ec)
+			return "capitals.idx";
+		return (executable.parent_path() / "capitals.idx").string();
+	}
 
-class SingletonDatabase : public Database {
 private:
-	SingletonDatabase() {
+	static capitals_index::MappedCapitals* open_index() {
+		const std::string path = index_path();
+		try {
+			return new capitals_index::MappedCapitals{path};
+		} catch (const std::exception& e) {
+			throw std::runtime_error(std::string{e.what()} + "; generate it with `BuildCapitalsIndex capitals.txt " + path +
+				"` or point CAPITALS_INDEX at an existing index");
+		}
+	}
+
+	// 数据来自 BuildCapitalsIndex 预先生成的索引文件, 构造时只做一次 mmap
+	SingletonDatabase() : capitals{open_index()} {
 		static int instance_count{0};
 		if (++instance_count > 1)
 			throw std::runtime_error("Cannot make >1 database!");
 	}
 
-	map<string, int> capitals;
+	// 当前快照; reload 时整体替换, 读者拿到的快照在 Guard 期间一直有效
+	std::atomic<const capitals_index::MappedCapitals*> capitals;
+	std::mutex reload_mutex;
+	// 每次 reload 加一, 线程私有的缓存据此判断自己是否过期
+	alignas(64) std::atomic<std::uint64_t> generation_{0};
 
 public:
 	SingletonDatabase(SingletonDatabase const&) = delete;
@@ -33,22 +80,126 @@ public:
 	}
 
 	int get_population(const std::string& name) override {
-		return capitals[name];
+		EpochDomain::Guard guard;
+		const auto population = capitals.load()->find(name);
+		return population ? *population : 0;
+	}
+
+	void get_populations(const std::string* names, int* populations, const std::size_t count) override {
+		constexpr std::size_t batch = 64;
+		std::string_view keys[batch];
+		EpochDomain::Guard guard;
+		const auto snapshot = capitals.load();
+		for (std::size_t base = 0; base < count; base += batch) {
+			const std::size_t n = std::min(batch, count - base);
+			std::copy(names + base, names + base + n, keys);
+			snapshot->find_batch(keys, populations + base, n);
+		}
+	}
+
+	// 在旁边映射好新的索引文件再一次性替换指针; 新文件有问题时抛异常, 旧数据保持不变.
+	// 正在读旧快照的线程不受影响, 旧快照等它们都离开后才 munmap
+	void reload(const std::string& path) {
+		auto next = std::make_unique<capitals_index::MappedCapitals>(path);
+
+		std::lock_guard<std::mutex> lock{reload_mutex};
+		const auto previous = capitals.exchange(next.release());
+		generation_.fetch_add(1);
+		EpochDomain::get().retire(previous);
+	}
+
+	[[nodiscard]] std::uint64_t generation() const {
+		return generation_.load(std::memory_order_acquire);
 	}
 };
 
+// 挡在共享的 SingletonDatabase 前面的线程私有查询缓存, 直接映射, 冲突时覆盖.
+// 命中时只读一次共享的 generation, 不进 epoch 临界区也不碰共享数据
+class LocalCapitalsCache {
+private:
+	struct Line {
+		std::string name;
+		int population{0};
+		std::uint64_t generation{0};
+		bool valid{false};
+	};
+
+	std::array<Line, 256> lines_;
+	std::uint64_t hits_{0};
+	std::uint64_t misses_{0};
+
+public:
+	int get_population(const std::string& name) {
+		auto& database = SingletonDatabase::get();
+		const std::uint64_t generation = database.generation();
+
+		Line& line = lines_[std::hash<std::string>{}(name) % lines_.size()];
+		if (line.valid && line.generation == generation && line.name == name) {
+			++hits_;
+			return line.population;
+		}
+
+		++misses_;
+		line.name = name;
+		line.population = database.get_population(name);
+		line.generation = generation;
+		line.valid = true;
+		return line.population;
+	}
+
+	[[nodiscard]] std::uint64_t hits() const { return hits_; }
+	[[nodiscard]] std::uint64_t misses() const { return misses_; }
+};
+
+// 以 Database 接口使用当前线程的那份缓存
+class PerThreadDatabase final : public Database {
+public:
+	int get_population(const std::string& name) override {
+		return per_thread_singleton<LocalCapitalsCache>::get().get_population(name);
+	}
+};
+
+inline int sum_populations(const int* populations, const std::size_t count) {
+	std::size_t i = 0;
+	int result = 0;
+#ifdef __SSE2__
+	__m128i acc0 = _mm_setzero_si128();
+	__m128i acc1 = _mm_setzero_si128();
+	for (; i + 8 <= count; i += 8) {
+		acc0 = _mm_add_epi32(acc0, _mm_loadu_si128(reinterpret_cast<const __m128i*>(populations + i)));
+		acc1 = _mm_add_epi32(acc1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(populations + i + 4)));
+	}
+	alignas(16) int lanes[4];
+	_mm_store_si128(reinterpret_cast<__m128i*>(lanes), _mm_add_epi32(acc0, acc1));
+	result = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+	for (; i < count; ++i)
+		result += populations[i];
+	return result;
+}
+
+// 每次把一批名字交给 get_populations, 一批只有一次虚调用
+inline int batched_total_population(Database& db, const std::vector<std::string>& names) {
+	constexpr std::size_t batch = 64;
+	int populations[batch];
+
+	int result = 0;
+	for (std::size_t base = 0; base < names.size(); base += batch) {
+		const std::size_t n = std::min(batch, names.size() - base);
+		db.get_populations(names.data() + base, populations, n);
+		result += sum_populations(populations, n);
+	}
+	return result;
+}
+
 struct SingletonRecordFinder {
 public:
 	static int total_population(const vector<string>& names) {
-		int result = 0;
-		for (auto& name : names)
-			result += SingletonDatabase::get().get_population(name);
-
-		return result;
+		return batched_total_population(SingletonDatabase::get(), names);
 	}
 };
 
-class DummyDatabase final : public Database {
+class DummyDatabase : public Database {
 private:
 	std::map<std::string, int> capitals;
 
@@ -59,8 +210,24 @@ public:
 		capitals["gamma"] = 3;
 	}
 
+	// 不用 operator[], 查询不修改 map, 多线程并发读也是安全的
+	int get_population(const std::string& name) override {
+		const auto it = capitals.find(name);
+		return it != capitals.end() ? it->second : 0;
+	}
+};
+
+// 模拟慢速后端: 每次查询前先等待固定的延迟
+class SlowDummyDatabase final : public DummyDatabase {
+private:
+	std::chrono::microseconds latency_;
+
+public:
+	explicit SlowDummyDatabase(const std::chrono::microseconds latency) : latency_{latency} {}
+
 	int get_population(const std::string& name) override {
-		return capitals[name];
+		std::this_thread::sleep_for(latency_);
+		return DummyDatabase::get_population(name);
 	}
 };
 
@@ -71,14 +238,131 @@ public:
 	explicit ConfigurableRecordFinder(Database& db) : db{db} {}
 
 	[[nodiscard]] int total_population(const std::vector<std::string>& names) const {
-		int result = 0;
-		for (auto& name : names)
-			result += db.get_population(name);
-
-		return result;
+		return batched_total_population(db, names);
 	}
 };
 
+void benchmark_caching_database() {
+	using clock = std::chrono::steady_clock;
+
+	SlowDummyDatabase slow{std::chrono::microseconds{100}};
+	CachingDatabase cached{slow, 64};
+
+	// 反复查询同一小批名字, 其中 delta 在后端并不存在
+	std::vector<std::string> names;
+	const std::string pool[] = {"alpha", "beta", "gamma", "delta"};
+	for (int i = 0; i < 2000; ++i)
+		names.push_back(pool[i % 4]);
+
+	auto run = [&](Database& db, const char* label) {
+		const auto start = clock::now();
+		const int total = ConfigurableRecordFinder{db}.total_population(names);
+		const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start);
+		std::cout << label << ": total " << total << " in " << elapsed.count() << " ms" << std::endl;
+	};
+
+	run(slow, "backing");
+	run(cached, "cached ");
+
+	const auto stats = cached.stats();
+	std::cout << "hits " << stats.hits << ", misses " << stats.misses
+		<< ", evictions " << stats.evictions << std::endl;
+}
+
+void benchmark_async_database() {
+	using clock = std::chrono::steady_clock;
+
+	SlowDummyDatabase slow{std::chrono::microseconds{200}};
+	ThreadPool pool{32};
+	ExecutorDatabase async{slow, pool};
+
+	std::vector<std::string> names;
+	const std::string pool_names[] = {"alpha", "beta", "gamma"};
+	for (int i = 0; i < 1000; ++i)
+		names.push_back(pool_names[i % 3]);
+
+	auto start = clock::now();
+	const int serial = ConfigurableRecordFinder{slow}.total_population(names);
+	const auto serial_ms = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start);
+
+	start = clock::now();
+	const int parallel = AsyncRecordFinder{async}.total_population(names);
+	const auto parallel_ms = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start);
+
+	std::cout << "serial:   total " << serial << " in " << serial_ms.count() << " ms" << std::endl;
+	std::cout << "parallel: total " << parallel << " in " << parallel_ms.count() << " ms ("
+		<< pool.size() << " threads)" << std::endl;
+}
+
+// 读线程不停查询, 同时主线程反复热加载两份人口不同的索引;
+// 每次读到的要么全是旧值要么全是新值, 不会是半新半旧
+void demo_hot_reload() {
+	// 临时索引和默认索引放在同一个目录, 不依赖当前工作目录
+	const auto directory = std::filesystem::path{SingletonDatabase::index_path()}.parent_path();
+	const std::string index_a = (directory / "capitals_a.idx").string();
+	const std::string index_b = (directory / "capitals_b.idx").string();
+	capitals_index::build_index({{"Tokyo", 1}, {"Seoul", 1}}, index_a);
+	capitals_index::build_index({{"Tokyo", 2}, {"Seoul", 2}}, index_b);
+
+	auto& db = SingletonDatabase::get();
+	db.reload(index_a);
+
+	std::atomic<bool> done{false};
+	std::atomic<int> torn{0};
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 4; ++t) {
+		readers.emplace_back([&] {
+			const std::vector<std::string> names{"Tokyo", "Seoul"};
+			while (!done.load()) {
+				const int total = SingletonRecordFinder::total_population(names);
+				if (total != 2 && total != 4)
+					++torn;
+			}
+		});
+	}
+
+	for (int i = 0; i < 1000; ++i)
+		db.reload(i % 2 ? index_a : index_b);
+	done = true;
+	for (auto& reader : readers)
+		reader.join();
+	EpochDomain::get().reclaim();
+
+	std::cout << "torn reads: " << torn << ", snapshots pending: " << EpochDomain::get().pending() << std::endl;
+}
+
+// 所有线程同时查询同一小批名字: 直接查全局单例 vs 先查各自的线程私有缓存
+void benchmark_per_thread_singleton() {
+	using clock = std::chrono::steady_clock;
+
+	const std::string names[] = {"Tokyo", "Seoul", "Delhi", "Osaka"};
+	const unsigned thread_count = std::max(2u, std::thread::hardware_concurrency());
+	constexpr int lookups = 1'000'000;
+
+	auto run = [&](auto&& lookup, const char* label) {
+		std::atomic<long long> checksum{0};
+		std::vector<std::thread> threads;
+		const auto start = clock::now();
+		for (unsigned t = 0; t < thread_count; ++t) {
+			threads.emplace_back([&] {
+				long long local = 0;
+				for (int i = 0; i < lookups; ++i)
+					local += lookup(names[i % 4]);
+				checksum += local;
+			});
+		}
+		for (auto& thread : threads)
+			thread.join();
+		const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start);
+		std::cout << label << ": " << elapsed.count() << " ms (checksum " << checksum << ")" << std::endl;
+	};
+
+	run([](const std::string& name) { return SingletonDatabase::get().get_population(name); }, "global    ");
+	run([](const std::string& name) {
+		return per_thread_singleton<LocalCapitalsCache>::get().get_population(name);
+	}, "per-thread");
+}
+
 TEST(RecordFinderTests, DummyTotalPopulationTest) {
 	DummyDatabase db{};
 	ConfigurableRecordFinder rf{db};
@@ -0,0 +1,261 @@
+#ifndef BITMAPCANVAS_HPP
+#define BITMAPCANVAS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Geometry.hpp"
+#include "LineRasterizer.hpp"
+
+// 每像素 1 bit 的画布, 作为 DrawPoints 的绘制目标.
+//
+// 每行按 64 像素一个 uint64_t 打包 (低位在左), 水平的一串点用掩码整字写入.
+// 画布按 64x64 分成 tile, 只有真正改变了某个 bit 的 tile 才被标脏,
+// 所以共享边上重复画的点不会产生额外的脏区域; flush 时只把脏区域写回 PBM 文件
+class BitmapCanvas {
+public:
+	struct Rect {
+		int x;
+		int y;
+		int width;
+		int height;
+	};
+
+	static constexpr int tile_size = 64;
+
+private:
+	int width_;
+	int height_;
+	std::size_t words_per_row_;
+	std::vector<std::uint64_t> bits_;
+	int tiles_x_;
+	int tiles_y_;
+	std::vector<std::uint8_t> dirty_;
+	std::string flushed_path_; // 上次完整写出的文件, 之后只增量更新它
+
+	void mark_dirty(const int word, const int y) {
+		dirty_[static_cast<std::size_t>(y / tile_size) * tiles_x_ + word] = 1;
+	}
+
+	[[nodiscard]] std::size_t pbm_row_bytes() const { return (static_cast<std::size_t>(width_) + 7) / 8; }
+
+	[[nodiscard]] std::string pbm_header() const {
+		return "P4\n" + std::to_string(width_) + " " + std::to_string(height_) + "\n";
+	}
+
+	// PBM 每字节最高位在左, 而画布的字是最低位在左
+	static std::uint8_t reverse_bits(std::uint8_t b) {
+		b = static_cast<std::uint8_t>((b & 0xF0) >> 4 | (b & 0x0F) << 4);
+		b = static_cast<std::uint8_t>((b & 0xCC) >> 2 | (b & 0x33) << 2);
+		b = static_cast<std::uint8_t>((b & 0xAA) >> 1 | (b & 0x55) << 1);
+		return b;
+	}
+
+	[[nodiscard]] std::uint8_t pbm_byte(const int y, const std::size_t byte) const {
+		const std::uint64_t word = bits_[y * words_per_row_ + byte / 8];
+		return reverse_bits(static_cast<std::uint8_t>(word >> (8 * (byte % 8))));
+	}
+
+	void write_rows(std::ostream& os, const int y0, const int y1, const std::size_t byte0, const std::size_t byte1) const {
+		const std::size_t header = pbm_header().size();
+		std::vector<char> row(byte1 - byte0);
+		for (int y = y0; y < y1; ++y) {
+			for (std::size_t b = byte0; b < byte1; ++b)
+				row[b - byte0] = static_cast<char>(pbm_byte(y, b));
+			os.seekp(static_cast<std::streamoff>(header + y * pbm_row_bytes() + byte0));
+			os.write(row.data(), static_cast<std::streamsize>(row.size()));
+		}
+	}
+
+public:
+	BitmapCanvas(const int width, const int height)
+		: width_{width}, height_{height},
+		  words_per_row_{(static_cast<std::size_t>(width) + 63) / 64},
+		  bits_(words_per_row_ * height, 0),
+		  tiles_x_{static_cast<int>(words_per_row_)},
+		  tiles_y_{(height + tile_size - 1) / tile_size},
+		  dirty_(static_cast<std::size_t>(tiles_x_) * tiles_y_, 1) {}
+
+	[[nodiscard]] int width() const { return width_; }
+	[[nodiscard]] int height() const { return height_; }
+
+	[[nodiscard]] bool get(const int x, const int y) const {
+		if (x < 0 || x >= width_ || y < 0 || y >= height_)
+			return false;
+		return bits_[y * words_per_row_ + x / 64] >> (x % 64) & 1;
+	}
+
+	void set(const int x, const int y) {
+		if (x < 0 || x >= width_ || y < 0 || y >= height_)
+			return;
+		std::uint64_t& word = bits_[y * words_per_row_ + x / 64];
+		const std::uint64_t mask = std::uint64_t{1} << (x % 64);
+		if (!(word & mask)) {
+			word |= mask;
+			mark_dirty(x / 64, y);
+		}
+	}
+
+	// 同一行上 [x0, x1] 的一串像素, 每个字只做一次或运算
+	void set_span(const int y, int x0, int x1) {
+		if (y < 0 || y >= height_)
+			return;
+		x0 = std::max(x0, 0);
+		x1 = std::min(x1, width_ - 1);
+		if (x0 > x1)
+			return;
+
+		std::uint64_t* row = bits_.data() + y * words_per_row_;
+		for (int w = x0 / 64; w <= x1 / 64; ++w) {
+			const int lo = std::max(x0, w * 64) - w * 64;
+			const int hi = std::min(x1, w * 64 + 63) - w * 64;
+			const std::uint64_t mask = (hi - lo == 63 ? ~std::uint64_t{0} : ((std::uint64_t{1} << (hi - lo + 1)) - 1)) << lo;
+			if ((row[w] & mask) != mask) {
+				row[w] |= mask;
+				mark_dirty(w, y);
+			}
+		}
+	}
+
+	void clear() {
+		for (std::size_t i = 0; i < bits_.size(); ++i) {
+			if (bits_[i]) {
+				bits_[i] = 0;
+				mark_dirty(static_cast<int>(i % words_per_row_), static_cast<int>(i / words_per_row_));
+			}
+		}
+	}
+
+	[[nodiscard]] std::size_t count() const {
+		std::size_t result = 0;
+		for (const std::uint64_t word : bits_)
+			result += static_cast<std::size_t>(__builtin_popcountll(word));
+		return result;
+	}
+
+	// 脏 tile 按行合并成矩形
+	[[nodiscard]] std::vector<Rect> dirty_rects() const {
+		std::vector<Rect> rects;
+		for (int ty = 0; ty < tiles_y_; ++ty) {
+			for (int tx = 0; tx < tiles_x_;) {
+				if (!dirty_[static_cast<std::size_t>(ty) * tiles_x_ + tx]) {
+					++tx;
+					continue;
+				}
+				const int first = tx;
+				while (tx < tiles_x_ && dirty_[static_cast<std::size_t>(ty) * tiles_x_ + tx])
+					++tx;
+				const int x = first * tile_size;
+				const int y = ty * tile_size;
+				rects.push_back(Rect{x, y, std::min(tx * tile_size, width_) - x, std::min(y + tile_size, height_) - y});
+			}
+		}
+		return rects;
+	}
+
+	// 写出为二进制 PBM (P4). 第一次写整幅图, 之后对同一个文件只覆盖脏区域对应的字节;
+	// 返回实际写入的像素字节数
+	std::size_t flush_pbm(const std::string& path) {
+		std::size_t written = 0;
+		if (path != flushed_path_) {
+			std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+			if (!ofs)
+				throw std::runtime_error("Cannot write " + path);
+			ofs << pbm_header();
+			std::vector<char> row(pbm_row_bytes());
+			for (int y = 0; y < height_; ++y) {
+				for (std::size_t b = 0; b < row.size(); ++b)
+					row[b] = static_cast<char>(pbm_byte(y, b));
+				ofs.write(row.data(), static_cast<std::streamsize>(row.size()));
+			}
+			written = row.size() * height_;
+			flushed_path_ = path;
+		} else {
+			std::fstream fs(path, std::ios::binary | std::ios::in | std::ios::out);
+			if (!fs)
+				throw std::runtime_error("Cannot update " + path);
+			for (const Rect& rect : dirty_rects()) {
+				const std::size_t byte0 = rect.x / 8;
+				const std::size_t byte1 = std::min(pbm_row_bytes(), (static_cast<std::size_t>(rect.x) + rect.width + 7) / 8);
+				write_rows(fs, rect.y, rect.y + rect.height, byte0, byte1);
+				written += (byte1 - byte0) * rect.height;
+			}
+		}
+		std::fill(dirty_.begin(), dirty_.end(), 0);
+		return written;
+	}
+};
+
+namespace detail {
+
+inline void flush_run(BitmapCanvas& dc, const Point& first, const Point& last) {
+	if (first.x == last.x)
+		dc.set(first.x, first.y);
+	else
+		dc.set_span(first.y, std::min(first.x, last.x), std::max(first.x, last.x));
+}
+
+} // namespace detail
+
+// 把一串点画到画布上: 连续的水平点合并成一段用 set_span 整字写入, 其余逐点写
+template <typename It>
+void DrawPoints(BitmapCanvas& dc, It begin, It end) {
+	if (begin == end)
+		return;
+
+	Point first = *begin;
+	Point last = first;
+	int direction = 0;
+	for (++begin; begin != end; ++begin) {
+		const Point p = *begin;
+		const int dx = p.x - last.x;
+		if (p.y == last.y && (dx == 1 || dx == -1) && (direction == 0 || direction == dx)) {
+			direction = dx;
+			last = p;
+			continue;
+		}
+		detail::flush_run(dc, first, last);
+		first = last = p;
+		direction = 0;
+	}
+	detail::flush_run(dc, first, last);
+}
+
+// 直接按扫描线画一条线段, 结果与 DrawPoints(dc, LinePoints{line}) 相同.
+// 偏水平的线每一行上是一段连续的点, 由 Bresenham 的闭式公式直接算出每行的起止下标,
+// 整段用 set_span 写入, 不用逐点生成; 偏竖直的线每行只有一个点, 逐点写
+inline void draw_line(BitmapCanvas& dc, const Line& line) {
+	const ::detail::LineSteps s{line};
+	if (!s.x_major || s.major == 0) {
+		for (auto&& p : LinePoints{line})
+			dc.set(p.x, p.y);
+		return;
+	}
+
+	const long long count = s.major + 1;
+	// 副轴坐标变为 k 的第一个点下标: ceil((2k - 1) * major / (2 * minor))
+	auto run_start = [&](const long long k) -> long long {
+		if (k == 0)
+			return 0;
+		if (k > s.minor)
+			return count;
+		const long long numerator = (2 * k - 1) * s.major;
+		const long long denominator = 2LL * s.minor;
+		return (numerator + denominator - 1) / denominator;
+	};
+
+	for (long long k = 0; k <= s.minor; ++k) {
+		const long long first = run_start(k);
+		const long long last = run_start(k + 1) - 1;
+		const int x0 = s.major_start + static_cast<int>(first) * s.major_step;
+		const int x1 = s.major_start + static_cast<int>(last) * s.major_step;
+		dc.set_span(s.minor_start + static_cast<int>(k) * s.minor_step, std::min(x0, x1), std::max(x0, x1));
+	}
+}
+
+#endif //BITMAPCANVAS_HPP
@@ -0,0 +1,14 @@
+#ifndef GEOMETRY_HPP
+#define GEOMETRY_HPP
+
+struct Point {
+	int x;
+	int y;
+};
+
+struct Line {
+	Point start;
+	Point end;
+};
+
+#endif //GEOMETRY_HPP
@@ -0,0 +1,148 @@
+#ifndef GEOMETRYSTORE_HPP
+#define GEOMETRYSTORE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <vector>
+
+#include "Geometry.hpp"
+
+// 连续内存的只读视图 (项目是 C++17, 没有 std::span)
+template <typename T>
+struct Span {
+	T* data{nullptr};
+	std::size_t size{0};
+
+	T* begin() const { return data; }
+	T* end() const { return data + size; }
+	T& operator[](const std::size_t i) const { return data[i]; }
+};
+
+// 一组线段的结构体数组 (SoA) 视图: 起点终点的 x / y 各自连续存放
+struct LineSpans {
+	Span<const int> x0;
+	Span<const int> y0;
+	Span<const int> x1;
+	Span<const int> y1;
+
+	[[nodiscard]] std::size_t size() const { return x0.size; }
+
+	[[nodiscard]] Line operator[](const std::size_t i) const {
+		return Line{Point{x0[i], y0[i]}, Point{x1[i], y1[i]}};
+	}
+};
+
+// 扁平的几何存储: 所有图形的所有线段放在同一组 SoA 数组里,
+// 每个图形只是其中的一段下标区间. 遍历整个场景不需要逐对象的虚调用和指针跳转,
+// 对坐标数组的循环可以被编译器直接向量化
+class GeometryStore {
+public:
+	using ShapeId = std::uint32_t;
+
+private:
+	struct ShapeRange {
+		std::uint32_t first;
+		std::uint32_t count;
+	};
+
+	std::vector<int> x0_, y0_, x1_, y1_;
+	std::vector<ShapeRange> shapes_;
+
+	[[nodiscard]] LineSpans slice(const std::size_t first, const std::size_t count) const {
+		return LineSpans{
+			{x0_.data() + first, count}, {y0_.data() + first, count},
+			{x1_.data() + first, count}, {y1_.data() + first, count}};
+	}
+
+public:
+	void reserve(const std::size_t lines, const std::size_t shapes) {
+		x0_.reserve(lines);
+		y0_.reserve(lines);
+		x1_.reserve(lines);
+		y1_.reserve(lines);
+		shapes_.reserve(shapes);
+	}
+
+	template <typename It>
+	ShapeId add_shape(It first, It last) {
+		const auto begin = static_cast<std::uint32_t>(x0_.size());
+		for (; first != last; ++first) {
+			const Line& line = *first;
+			x0_.push_back(line.start.x);
+			y0_.push_back(line.start.y);
+			x1_.push_back(line.end.x);
+			y1_.push_back(line.end.y);
+		}
+		shapes_.push_back(ShapeRange{begin, static_cast<std::uint32_t>(x0_.size()) - begin});
+		return static_cast<ShapeId>(shapes_.size() - 1);
+	}
+
+	// 与 VectorRectangle 相同的四条边
+	ShapeId add_rectangle(const int x, const int y, const int width, const int height) {
+		const Line lines[] = {
+			Line{Point{x, y}, Point{x + width, y}},
+			Line{Point{x + width, y}, Point{x + width, y + height}},
+			Line{Point{x + width, y + height}, Point{x, y + height}},
+			Line{Point{x, y + height}, Point{x, y}}};
+		return add_shape(std::begin(lines), std::end(lines));
+	}
+
+	[[nodiscard]] std::size_t shape_count() const { return shapes_.size(); }
+	[[nodiscard]] std::size_t line_count() const { return x0_.size(); }
+
+	// 整个场景
+	[[nodiscard]] LineSpans lines() const { return slice(0, x0_.size()); }
+
+	// 单个图形
+	[[nodiscard]] LineSpans lines(const ShapeId shape) const {
+		return slice(shapes_[shape].first, shapes_[shape].count);
+	}
+
+	// 平移一个图形的全部线段
+	void translate(const ShapeId shape, const int dx, const int dy) {
+		const std::size_t first = shapes_[shape].first;
+		const std::size_t last = first + shapes_[shape].count;
+		for (std::size_t i = first; i < last; ++i) {
+			x0_[i] += dx;
+			x1_[i] += dx;
+			y0_[i] += dy;
+			y1_[i] += dy;
+		}
+	}
+
+	// 平移整个场景
+	void translate(const int dx, const int dy) {
+		const std::size_t n = x0_.size();
+		int* x0 = x0_.data();
+		int* y0 = y0_.data();
+		int* x1 = x1_.data();
+		int* y1 = y1_.data();
+		for (std::size_t i = 0; i < n; ++i) {
+			x0[i] += dx;
+			x1[i] += dx;
+			y0[i] += dy;
+			y1[i] += dy;
+		}
+	}
+};
+
+// 一组线段光栅化后的总点数, 即每条线 max(|dx|, |dy|) + 1 之和, 可以一次性算出需要预留的空间
+inline std::size_t total_point_count(const LineSpans& lines) {
+	const std::size_t n = lines.size();
+	const int* x0 = lines.x0.data;
+	const int* y0 = lines.y0.data;
+	const int* x1 = lines.x1.data;
+	const int* y1 = lines.y1.data;
+	long long total = 0;
+	for (std::size_t i = 0; i < n; ++i) {
+		const int adx = std::abs(x1[i] - x0[i]);
+		const int ady = std::abs(y1[i] - y0[i]);
+		total += std::max(adx, ady) + 1;
+	}
+	return static_cast<std::size_t>(total);
+}
+
+#endif //GEOMETRYSTORE_HPP
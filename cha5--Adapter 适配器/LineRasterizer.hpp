@@ -0,0 +1,230 @@
+#ifndef LINERASTERIZER_HPP
+#define LINERASTERIZER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <iterator>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "Geometry.hpp"
+
+// 任意斜率的整数 Bresenham 光栅化.
+//
+// 沿主轴(|dx|, |dy| 中较大的那个)每步走 1, 第 i 个点在副轴上的偏移为
+// floor((2 * i * minor + major) / (2 * major)), 即 i * minor / major 四舍五入(0.5 向上),
+// 标量版本用增量的余数递推, SIMD 版本一次递推 4 个点, 两者结果逐点相同.
+// 点的顺序总是从 start 走到 end, 总数恰好是 point_count(line).
+
+inline std::size_t point_count(const Line& line) {
+	const int adx = std::abs(line.end.x - line.start.x);
+	const int ady = std::abs(line.end.y - line.start.y);
+	return static_cast<std::size_t>(std::max(adx, ady)) + 1;
+}
+
+namespace detail {
+
+// 光栅化所需的全部状态, 标量/SIMD 以及惰性迭代共用
+struct LineSteps {
+	int major_start; // 主轴起点坐标
+	int minor_start; // 副轴起点坐标
+	int major_step;  // 主轴方向 +1 / -1
+	int minor_step;  // 副轴方向 +1 / -1
+	int major;       // 主轴长度
+	int minor;       // 副轴长度
+	bool x_major;
+
+	explicit LineSteps(const Line& line) {
+		const int dx = line.end.x - line.start.x;
+		const int dy = line.end.y - line.start.y;
+		x_major = std::abs(dx) >= std::abs(dy);
+		major_start = x_major ? line.start.x : line.start.y;
+		minor_start = x_major ? line.start.y : line.start.x;
+		const int d_major = x_major ? dx : dy;
+		const int d_minor = x_major ? dy : dx;
+		major_step = d_major < 0 ? -1 : 1;
+		minor_step = d_minor < 0 ? -1 : 1;
+		major = std::abs(d_major);
+		minor = std::abs(d_minor);
+	}
+
+	[[nodiscard]] Point make_point(const int major_coord, const int minor_coord) const {
+		return x_major ? Point{major_coord, minor_coord} : Point{minor_coord, major_coord};
+	}
+};
+
+// 从第 first 个点开始标量地写出 [first, count) 的点; q, r 是第 first 个点的商和余数
+inline void rasterize_tail(const LineSteps& s, Point* out, std::size_t first, const std::size_t count,
+                           int q, int r) {
+	const int two_major = 2 * s.major;
+	const int two_minor = 2 * s.minor;
+	for (std::size_t i = first; i < count; ++i) {
+		out[i] = s.make_point(s.major_start + static_cast<int>(i) * s.major_step,
+		                      s.minor_start + q * s.minor_step);
+		r += two_minor;
+		if (r >= two_major) {
+			r -= two_major;
+			++q;
+		}
+	}
+}
+
+} // namespace detail
+
+// 标量版本: out 至少要有 point_count(line) 个位置
+inline void rasterize_line_scalar(const Line& line, Point* out) {
+	const detail::LineSteps s{line};
+	if (s.major == 0) {
+		out[0] = line.start;
+		return;
+	}
+	detail::rasterize_tail(s, out, 0, point_count(line), 0, s.major);
+}
+
+// 长线段走 SIMD 路径, 每次生成 4 个点; 短线段和不支持 SSE2 的平台退回标量版本
+inline void rasterize_line(const Line& line, Point* out) {
+#ifdef __SSE2__
+	const std::size_t count = point_count(line);
+	if (count < 16) {
+		rasterize_line_scalar(line, out);
+		return;
+	}
+
+	const detail::LineSteps s{line};
+	const int two_major = 2 * s.major;
+
+	// 4 个 lane 分别对应第 i, i+1, i+2, i+3 个点, 每轮各前进 4 步:
+	// 分子每轮增加 8 * minor = step_q * 2major + step_r
+	const int step_q = (8 * s.minor) / two_major;
+	const int step_r = (8 * s.minor) % two_major;
+
+	alignas(16) int q0[4], r0[4];
+	for (int k = 0; k < 4; ++k) {
+		const long long numerator = 2LL * k * s.minor + s.major;
+		q0[k] = static_cast<int>(numerator / two_major);
+		r0[k] = static_cast<int>(numerator % two_major);
+	}
+
+	__m128i q = _mm_load_si128(reinterpret_cast<const __m128i*>(q0));
+	__m128i r = _mm_load_si128(reinterpret_cast<const __m128i*>(r0));
+	__m128i major_coord = _mm_setr_epi32(s.major_start, s.major_start + s.major_step,
+	                                     s.major_start + 2 * s.major_step, s.major_start + 3 * s.major_step);
+	const __m128i major_inc = _mm_set1_epi32(4 * s.major_step);
+	const __m128i minor_base = _mm_set1_epi32(s.minor_start);
+	const __m128i minor_sign = _mm_set1_epi32(s.minor_step < 0 ? -1 : 0);
+	const __m128i inc_q = _mm_set1_epi32(step_q);
+	const __m128i inc_r = _mm_set1_epi32(step_r);
+	const __m128i wrap = _mm_set1_epi32(two_major);
+	const __m128i wrap_limit = _mm_set1_epi32(two_major - 1);
+
+	std::size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		// 副轴坐标 = minor_start +/- q, 用异或减法做条件取负
+		const __m128i minor_coord = _mm_add_epi32(minor_base,
+			_mm_sub_epi32(_mm_xor_si128(q, minor_sign), minor_sign));
+		const __m128i xs = s.x_major ? major_coord : minor_coord;
+		const __m128i ys = s.x_major ? minor_coord : major_coord;
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_unpacklo_epi32(xs, ys));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 2), _mm_unpackhi_epi32(xs, ys));
+
+		major_coord = _mm_add_epi32(major_coord, major_inc);
+		q = _mm_add_epi32(q, inc_q);
+		r = _mm_add_epi32(r, inc_r);
+		const __m128i carry = _mm_cmpgt_epi32(r, wrap_limit); // r >= 2major 的 lane 为 -1
+		r = _mm_sub_epi32(r, _mm_and_si128(carry, wrap));
+		q = _mm_sub_epi32(q, carry);
+	}
+
+	alignas(16) int q_tail[4], r_tail[4];
+	_mm_store_si128(reinterpret_cast<__m128i*>(q_tail), q);
+	_mm_store_si128(reinterpret_cast<__m128i*>(r_tail), r);
+	detail::rasterize_tail(s, out, i, count, q_tail[0], r_tail[0]);
+#else
+	rasterize_line_scalar(line, out);
+#endif
+}
+
+// 惰性的点序列: 不分配任何存储, 迭代器只保存当前点的下标和 Bresenham 的商/余数,
+// 每次 ++ 现算下一个点, 可以直接用于 range-for 或者接受迭代器对的绘制函数
+class LinePoints {
+public:
+	class iterator {
+	private:
+		const detail::LineSteps* steps_{nullptr};
+		std::size_t index_{0};
+		int q_{0};
+		int r_{0};
+
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = Point;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const Point*;
+		using reference = Point;
+
+		iterator() = default;
+		// 直接定位到第 index 个点, 商和余数由闭式公式算出
+		iterator(const detail::LineSteps* steps, const std::size_t index) : steps_{steps}, index_{index} {
+			if (steps->major == 0)
+				return;
+			const long long numerator = 2LL * static_cast<long long>(index) * steps->minor + steps->major;
+			q_ = static_cast<int>(numerator / (2LL * steps->major));
+			r_ = static_cast<int>(numerator % (2LL * steps->major));
+		}
+
+		Point operator*() const {
+			return steps_->make_point(steps_->major_start + static_cast<int>(index_) * steps_->major_step,
+			                          steps_->minor_start + q_ * steps_->minor_step);
+		}
+
+		iterator& operator++() {
+			++index_;
+			r_ += 2 * steps_->minor;
+			if (r_ >= 2 * steps_->major) {
+				r_ -= 2 * steps_->major;
+				++q_;
+			}
+			return *this;
+		}
+
+		iterator operator++(int) {
+			iterator previous = *this;
+			++*this;
+			return previous;
+		}
+
+		bool operator==(const iterator& other) const { return index_ == other.index_; }
+		bool operator!=(const iterator& other) const { return index_ != other.index_; }
+	};
+
+private:
+	detail::LineSteps steps_;
+	std::size_t count_;
+
+public:
+	explicit LinePoints(const Line& line) : steps_{line}, count_{point_count(line)} {}
+
+	[[nodiscard]] iterator begin() const { return iterator{&steps_, 0}; }
+	[[nodiscard]] iterator end() const { return iterator{&steps_, count_}; }
+	[[nodiscard]] iterator at(const std::size_t index) const { return iterator{&steps_, index}; }
+	[[nodiscard]] std::size_t size() const { return count_; }
+
+	// 主轴坐标落在 [lo, hi] 内的点的下标区间 [first, last), 用于按区域裁剪
+	[[nodiscard]] std::pair<std::size_t, std::size_t> major_range(const int lo, const int hi) const {
+		long long first = steps_.major_step > 0 ? lo - steps_.major_start : steps_.major_start - hi;
+		long long last = (steps_.major_step > 0 ? hi - steps_.major_start : steps_.major_start - lo) + 1;
+		first = std::max(first, 0LL);
+		last = std::min(last, static_cast<long long>(count_));
+		if (first >= last)
+			return {0, 0};
+		return {static_cast<std::size_t>(first), static_cast<std::size_t>(last)};
+	}
+
+	[[nodiscard]] bool x_major() const { return steps_.x_major; }
+};
+
+#endif //LINERASTERIZER_HPP
@@ -0,0 +1,95 @@
+#ifndef POINTCACHE_HPP
+#define POINTCACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Geometry.hpp"
+#include "LineRasterizer.hpp"
+
+struct LineHash {
+	std::size_t operator()(const Line& line) const {
+		// 和 boost::hash_combine 相同的组合方式
+		std::size_t seed = 0;
+		for (const int v : {line.start.x, line.start.y, line.end.x, line.end.y})
+			seed ^= std::hash<int>{}(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+		return seed;
+	}
+};
+
+struct LineEqual {
+	bool operator()(const Line& l, const Line& r) const {
+		return l.start.x == r.start.x && l.start.y == r.start.y &&
+			l.end.x == r.end.x && l.end.y == r.end.y;
+	}
+};
+
+// 按 Line 缓存光栅化结果, 容量按缓存的点数计算, 超出后淘汰最久未用的线段.
+// 点集用 shared_ptr 持有, 被淘汰时正在使用它的适配器依然有效
+class PointCache {
+public:
+	using Points = std::vector<Point>;
+
+	struct Stats {
+		std::uint64_t hits;
+		std::uint64_t misses;
+		std::uint64_t evictions;
+		std::size_t points;
+
+		[[nodiscard]] double hit_rate() const {
+			const auto total = hits + misses;
+			return total ? static_cast<double>(hits) / total : 0.0;
+		}
+	};
+
+private:
+	using Entry = std::pair<Line, std::shared_ptr<const Points>>;
+
+	std::size_t capacity_;
+	std::size_t size_{0};
+	std::list<Entry> lru_; // 表头是最近使用的
+	std::unordered_map<Line, std::list<Entry>::iterator, LineHash, LineEqual> index_;
+	std::uint64_t hits_{0};
+	std::uint64_t misses_{0};
+	std::uint64_t evictions_{0};
+
+public:
+	explicit PointCache(const std::size_t capacity_points) : capacity_{capacity_points} {}
+
+	std::shared_ptr<const Points> get(const Line& line) {
+		if (const auto it = index_.find(line); it != index_.end()) {
+			lru_.splice(lru_.begin(), lru_, it->second);
+			++hits_;
+			return it->second->second;
+		}
+
+		++misses_;
+		auto points = std::make_shared<Points>(point_count(line));
+		rasterize_line(line, points->data());
+
+		lru_.emplace_front(line, points);
+		index_.emplace(line, lru_.begin());
+		size_ += points->size();
+
+		// 至少保留刚放进去的这一条
+		while (size_ > capacity_ && lru_.size() > 1) {
+			size_ -= lru_.back().second->size();
+			index_.erase(lru_.back().first);
+			lru_.pop_back();
+			++evictions_;
+		}
+		return points;
+	}
+
+	[[nodiscard]] Stats stats() const {
+		return Stats{hits_, misses_, evictions_, size_};
+	}
+};
+
+#endif //POINTCACHE_HPP
@@ -0,0 +1,136 @@
+#ifndef SCENERASTERIZER_HPP
+#define SCENERASTERIZER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Geometry.hpp"
+#include "GeometryStore.hpp"
+#include "LineRasterizer.hpp"
+#include "WorkStealingPool.hpp"
+
+// 每像素一个字节的帧缓冲, 非 0 表示该点被画过
+struct Framebuffer {
+	int width;
+	int height;
+	std::vector<std::uint8_t> pixels;
+
+	Framebuffer(const int width, const int height)
+		: width{width}, height{height}, pixels(static_cast<std::size_t>(width) * height, 0) {}
+
+	void clear() { std::fill(pixels.begin(), pixels.end(), 0); }
+
+	void set(const int x, const int y) {
+		if (x >= 0 && x < width && y >= 0 && y < height)
+			pixels[static_cast<std::size_t>(y) * width + x] = 1;
+	}
+
+	bool operator==(const Framebuffer& other) const {
+		return width == other.width && height == other.height && pixels == other.pixels;
+	}
+};
+
+// 单线程参照实现: 逐条线段交给 LineToPointAdapter 同样的光栅化
+inline void rasterize_lines_serial(const std::vector<Line>& lines, Framebuffer& framebuffer) {
+	for (auto& line : lines)
+		for (auto&& p : LinePoints{line})
+			framebuffer.set(p.x, p.y);
+}
+
+inline void rasterize_lines_serial(const LineSpans& lines, Framebuffer& framebuffer) {
+	for (std::size_t i = 0; i < lines.size(); ++i)
+		for (auto&& p : LinePoints{lines[i]})
+			framebuffer.set(p.x, p.y);
+}
+
+// 分块并行光栅化:
+// 1. 沿主轴按 tile 边界把线段切成若干段, 每段的副轴范围由两端的点决定,
+//    只放进这一段真正经过的 tile (斜线每段通常只占一两个 tile, 而不是包围盒覆盖的全部 tile);
+// 2. 每个 tile 一个任务, 交给 work stealing 线程池;
+// 3. 任务只走自己那一段的点, 只写自己 tile 内的像素, tile 互不重叠, 所以写帧缓冲不需要加锁.
+// 结果与串行版本逐像素相同
+class TiledSceneRasterizer {
+private:
+	// 第 line 条线段下标在 [first, last) 内的点
+	struct Segment {
+		std::uint32_t line;
+		std::uint32_t first;
+		std::uint32_t last;
+	};
+
+	WorkStealingPool& pool_;
+	int tile_size_;
+	std::vector<std::vector<Segment>> bins_;
+
+public:
+	explicit TiledSceneRasterizer(WorkStealingPool& pool, const int tile_size = 128)
+		: pool_{pool}, tile_size_{std::max(1, tile_size)} {}
+
+	void rasterize(const std::vector<Line>& lines, Framebuffer& framebuffer) {
+		rasterize(lines.size(), [&](const std::size_t i) { return lines[i]; }, framebuffer);
+	}
+
+	void rasterize(const LineSpans& lines, Framebuffer& framebuffer) {
+		rasterize(lines.size(), [&](const std::size_t i) { return lines[i]; }, framebuffer);
+	}
+
+private:
+	template <typename LineAt>
+	void rasterize(const std::size_t count, LineAt line_at, Framebuffer& framebuffer) {
+		const int tiles_x = (framebuffer.width + tile_size_ - 1) / tile_size_;
+		const int tiles_y = (framebuffer.height + tile_size_ - 1) / tile_size_;
+		bins_.resize(static_cast<std::size_t>(tiles_x) * tiles_y);
+		for (auto& bin : bins_)
+			bin.clear();
+
+		for (std::uint32_t i = 0; i < count; ++i) {
+			const Line line = line_at(i);
+			const LinePoints points{line};
+			const bool x_major = points.x_major();
+			const int major_extent = x_major ? framebuffer.width : framebuffer.height;
+			const int minor_extent = x_major ? framebuffer.height : framebuffer.width;
+			const int major_lo = std::max(0, x_major ? std::min(line.start.x, line.end.x) : std::min(line.start.y, line.end.y));
+			const int major_hi = std::min(major_extent - 1, x_major ? std::max(line.start.x, line.end.x) : std::max(line.start.y, line.end.y));
+
+			// 主轴上每个 tile 宽的一段, 副轴坐标单调, 范围就是首尾两点之间
+			for (int m0 = major_lo / tile_size_ * tile_size_; m0 <= major_hi; m0 += tile_size_) {
+				const auto [first, last] = points.major_range(m0, std::min(m0 + tile_size_, major_extent) - 1);
+				if (first >= last)
+					continue;
+				const Point a = *points.at(first);
+				const Point b = *points.at(last - 1);
+				const int minor_lo = std::max(0, x_major ? std::min(a.y, b.y) : std::min(a.x, b.x));
+				const int minor_hi = std::min(minor_extent - 1, x_major ? std::max(a.y, b.y) : std::max(a.x, b.x));
+				if (minor_lo > minor_hi)
+					continue;
+				const Segment segment{i, static_cast<std::uint32_t>(first), static_cast<std::uint32_t>(last)};
+				for (int t = minor_lo / tile_size_; t <= minor_hi / tile_size_; ++t) {
+					const int tx = x_major ? m0 / tile_size_ : t;
+					const int ty = x_major ? t : m0 / tile_size_;
+					bins_[static_cast<std::size_t>(ty) * tiles_x + tx].push_back(segment);
+				}
+			}
+		}
+
+		pool_.parallel_for(bins_.size(), [&](const std::size_t tile) {
+			const int left = static_cast<int>(tile % tiles_x) * tile_size_;
+			const int top = static_cast<int>(tile / tiles_x) * tile_size_;
+			const int right = std::min(left + tile_size_, framebuffer.width) - 1;
+			const int bottom = std::min(top + tile_size_, framebuffer.height) - 1;
+
+			for (const Segment& segment : bins_[tile]) {
+				const LinePoints points{line_at(segment.line)};
+				auto it = points.at(segment.first);
+				for (std::uint32_t k = segment.first; k < segment.last; ++k, ++it) {
+					const Point p = *it;
+					if (p.x >= left && p.x <= right && p.y >= top && p.y <= bottom)
+						framebuffer.pixels[static_cast<std::size_t>(p.y) * framebuffer.width + p.x] = 1;
+				}
+			}
+		});
+	}
+};
+
+#endif //SCENERASTERIZER_HPP
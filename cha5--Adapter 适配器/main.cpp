@@ -1,15 +1,16 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
 #include <vector>
 #include <memory>
 
-struct Point {
-	int x;
-	int y;
-};
-
-struct Line {
-	Point start;
-	Point end;
-};
+#include "BitmapCanvas.hpp"
+#include "Geometry.hpp"
+#include "GeometryStore.hpp"
+#include "LineRasterizer.hpp"
+#include "PointCache.hpp"
+#include "SceneRasterizer.hpp"
 
 struct VectorObject {
 	virtual ~VectorObject() = default;
@@ -51,27 +52,10 @@ private:
 	Points points;
 
 public:
-	// 直接在构造函数中完成转换
+	// 直接在构造函数中完成转换, 任意斜率都适用, 一次分配恰好够用的空间
 	explicit LineToPointAdapter(const Line& line) {
-		const int left   = std::min(line.start.x, line.end.x);
-		const int right  = std::max(line.start.x, line.end.x);
-		const int bottom = std::min(line.start.y, line.end.y);
-		const int top    = std::max(line.start.y, line.end.y);
-		const int dx     = right - left;
-		const int dy     = top - bottom;
-
-		// 仅适用于水平线和垂直线
-		if (dx == 0) {
-			// 对于垂直线
-			for (int y = bottom; y <= top; ++y) {
-				points.emplace_back( Point{left, y} );
-			}
-		} else if (dy == 0) {
-			// 对于水平线
-			for (int x = left; x <= right; ++x) {
-				points.emplace_back( Point{x, top} );
-			}
-		}
+		points.resize(point_count(line));
+		rasterize_line(line, points.data());
 	}
 	virtual ~LineToPointAdapter() = default;
 
@@ -83,10 +67,348 @@ public:
 	}
 };
 
-void dosomething() {
+// 面向扁平几何存储的适配器: 一次把一整段线段 (一个图形或整个场景) 转换成点,
+// 先用 total_point_count 精确预留空间, 再逐条写入
+struct SpanToPointAdapter final {
+public:
+	using Points = std::vector<Point>;
+
+private:
+	Points points;
+
+public:
+	explicit SpanToPointAdapter(const LineSpans& lines) {
+		points.resize(total_point_count(lines));
+		std::size_t offset = 0;
+		for (std::size_t i = 0; i < lines.size(); ++i) {
+			const Line line = lines[i];
+			rasterize_line(line, points.data() + offset);
+			offset += point_count(line);
+		}
+	}
+
+	[[nodiscard]] Points::const_iterator begin() const {
+		return points.begin();
+	}
+	[[nodiscard]] Points::const_iterator end() const {
+		return points.end();
+	}
+};
+
+// 带缓存的适配器: 相同的线段只光栅化一次, 之后每帧只是一次哈希查找
+struct LineToPointCachingAdapter final {
+public:
+	using Points = std::vector<Point>;
+
+private:
+	std::shared_ptr<const Points> points_;
+
+public:
+	static PointCache& cache() {
+		static PointCache cache{1 << 20};
+
+		return cache;
+	}
+
+	explicit LineToPointCachingAdapter(const Line& line) : points_{cache().get(line)} {}
+
+	[[nodiscard]] Points::const_iterator begin() const {
+		return points_->begin();
+	}
+	[[nodiscard]] Points::const_iterator end() const {
+		return points_->end();
+	}
+};
+
+void report_cache_stats() {
+	const auto stats = LineToPointCachingAdapter::cache().stats();
+	std::cout << "point cache: " << stats.hits << " hits, " << stats.misses << " misses, "
+		<< stats.evictions << " evictions, hit rate " << stats.hit_rate() * 100 << "%, "
+		<< stats.points << " points cached" << std::endl;
+}
+
+// 随机斜率和长度的线段, 对比标量和 SIMD 两条路径
+void benchmark_line_rasterizer() {
+	using clock = std::chrono::steady_clock;
+
+	std::mt19937 rng{42};
+	std::uniform_int_distribution<int> coord{0, 2000};
+	std::vector<Line> lines(20000);
+	for (auto& line : lines)
+		line = Line{Point{coord(rng), coord(rng)}, Point{coord(rng), coord(rng)}};
+
+	std::vector<Point> scalar_points, simd_points;
+	auto run = [&](auto rasterize, std::vector<Point>& points, const char* label) {
+		const auto start = clock::now();
+		for (int pass = 0; pass < 10; ++pass) {
+			points.clear();
+			for (auto& line : lines) {
+				const std::size_t offset = points.size();
+				points.resize(offset + point_count(line));
+				rasterize(line, points.data() + offset);
+			}
+		}
+		const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+		std::cout << label << ": " << points.size() * 10 / std::max<long long>(1, elapsed.count())
+			<< " Mpoints/s" << std::endl;
+	};
+
+	run(rasterize_line_scalar, scalar_points, "scalar");
+	run(rasterize_line, simd_points, "simd  ");
+
+	bool same = scalar_points.size() == simd_points.size();
+	for (std::size_t i = 0; same && i < scalar_points.size(); ++i)
+		same = scalar_points[i].x == simd_points[i].x && scalar_points[i].y == simd_points[i].y;
+	std::cout << "identical output: " << std::boolalpha << same << std::endl;
+}
+
+// 同一组静态矩形重复绘制多帧, 第一帧之后全部命中缓存
+void benchmark_caching_adapter() {
+	using clock = std::chrono::steady_clock;
+
+	std::vector<std::shared_ptr<VectorRectangle>> rectangles;
+	for (int i = 0; i < 100; ++i)
+		rectangles.push_back(std::make_shared<VectorRectangle>(i * 7, i * 5, 400, 300));
+
+	auto run = [&](auto make_adapter, const char* label) {
+		long long checksum = 0;
+		const auto start = clock::now();
+		for (int frame = 0; frame < 100; ++frame) {
+			for (auto&& o : rectangles) {
+				for (auto&& l : *o) {
+					auto lpo = make_adapter(l);
+					for (auto&& p : lpo)
+						checksum += p.x;
+				}
+			}
+		}
+		const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start);
+		std::cout << label << ": " << elapsed.count() << " ms (checksum " << checksum << ")" << std::endl;
+	};
+
+	run([](const Line& l) { return LineToPointAdapter{ l }; }, "uncached");
+	run([](const Line& l) { return LineToPointCachingAdapter{ l }; }, "cached  ");
+	report_cache_stats();
+}
+
+// 逐点消费整幅场景: 物化成 vector 再遍历 vs 惰性地边算边用
+void benchmark_lazy_adapter() {
+	using clock = std::chrono::steady_clock;
+
+	std::mt19937 rng{7};
+	std::uniform_int_distribution<int> coord{0, 4000};
+	std::vector<Line> lines(5000);
+	for (auto& line : lines)
+		line = Line{Point{coord(rng), coord(rng)}, Point{coord(rng), coord(rng)}};
+
+	auto run = [&](auto make_range, const char* label) {
+		long long checksum = 0;
+		const auto start = clock::now();
+		for (int pass = 0; pass < 20; ++pass) {
+			for (auto& line : lines) {
+				auto range = make_range(line);
+				for (auto&& p : range)
+					checksum += p.x ^ p.y;
+			}
+		}
+		const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start);
+		std::cout << label << ": " << elapsed.count() << " ms (checksum " << checksum << ")" << std::endl;
+	};
+
+	run([](const Line& l) { return LineToPointAdapter{ l }; }, "materialized");
+	run([](const Line& l) { return LinePoints{ l }; }, "lazy        ");
+}
+
+// 把场景里所有 VectorObject 的边收集成一个线段列表
+std::vector<Line> collect_lines(const std::vector<std::shared_ptr<VectorObject>>& objects) {
+	std::vector<Line> lines;
+	for (auto&& o : objects)
+		lines.insert(lines.end(), o->begin(), o->end());
+	return lines;
+}
+
+// 上万个矩形的大场景: 串行逐线光栅化 vs 分块并行光栅化, 并检查两者逐像素一致
+void benchmark_tiled_rasterizer() {
+	using clock = std::chrono::steady_clock;
+
+	std::mt19937 rng{1};
+	std::uniform_int_distribution<int> position{-100, 4000};
+	std::uniform_int_distribution<int> extent{1, 600};
+	std::vector<std::shared_ptr<VectorObject>> scene;
+	for (int i = 0; i < 20000; ++i)
+		scene.push_back(std::make_shared<VectorRectangle>(position(rng), position(rng), extent(rng), extent(rng)));
+	const auto lines = collect_lines(scene);
+
+	Framebuffer serial{4096, 4096};
+	Framebuffer tiled{4096, 4096};
+	WorkStealingPool pool;
+	TiledSceneRasterizer rasterizer{pool};
+
+	auto start = clock::now();
+	rasterize_lines_serial(lines, serial);
+	const auto serial_ms = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start);
+
+	start = clock::now();
+	rasterizer.rasterize(lines, tiled);
+	const auto tiled_ms = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start);
+
+	std::cout << "serial: " << serial_ms.count() << " ms, tiled (" << pool.size() << " threads): "
+		<< tiled_ms.count() << " ms, identical: " << std::boolalpha << (serial == tiled) << std::endl;
+
+	// 任意方向的长斜线, 不少端点在画面外: 每条线只进入它真正经过的 tile
+	std::uniform_int_distribution<int> endpoint{-1000, 5000};
+	std::vector<Line> diagonals;
+	for (int i = 0; i < 5000; ++i)
+		diagonals.push_back(Line{Point{endpoint(rng), endpoint(rng)}, Point{endpoint(rng), endpoint(rng)}});
+	serial.clear();
+	tiled.clear();
+
+	start = clock::now();
+	rasterize_lines_serial(diagonals, serial);
+	const auto serial_diagonal_ms = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start);
+
+	start = clock::now();
+	rasterizer.rasterize(diagonals, tiled);
+	const auto tiled_diagonal_ms = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start);
+
+	std::cout << "diagonals serial: " << serial_diagonal_ms.count() << " ms, tiled: " << tiled_diagonal_ms.count()
+		<< " ms, identical: " << (serial == tiled) << std::endl;
+}
+
+// 同一个场景分别以 VectorObject 列表和 GeometryStore 表示: 平移整个场景并统计总点数
+void benchmark_geometry_store() {
+	using clock = std::chrono::steady_clock;
+
+	std::mt19937 rng{3};
+	std::uniform_int_distribution<int> position{0, 4000};
+	std::uniform_int_distribution<int> extent{1, 300};
+
+	std::vector<std::shared_ptr<VectorObject>> objects;
+	GeometryStore store;
+	store.reserve(4 * 200000, 200000);
+	for (int i = 0; i < 200000; ++i) {
+		const int x = position(rng), y = position(rng), w = extent(rng), h = extent(rng);
+		objects.push_back(std::make_shared<VectorRectangle>(x, y, w, h));
+		store.add_rectangle(x, y, w, h);
+	}
+
+	auto start = clock::now();
+	std::size_t object_points = 0;
+	for (int pass = 0; pass < 10; ++pass) {
+		for (auto&& o : objects) {
+			for (auto&& l : *o) {
+				l.start.x += 1;
+				l.end.x += 1;
+				object_points += point_count(l);
+			}
+		}
+	}
+	const auto object_us = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+	start = clock::now();
+	std::size_t store_points = 0;
+	for (int pass = 0; pass < 10; ++pass) {
+		store.translate(1, 0);
+		store_points += total_point_count(store.lines());
+	}
+	const auto store_us = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+	std::cout << "objects: " << object_us.count() << " us, store: " << store_us.count() << " us, points "
+		<< object_points << " / " << store_points << std::endl;
+
+	// 前 20000 个图形转换成点: 逐条线段的 LineToPointAdapter vs 每个图形一次的 SpanToPointAdapter, 结果逐点比较
+	constexpr std::size_t converted = 20000;
+	std::size_t converted_points = 0;
+	for (std::size_t i = 0; i < converted; ++i)
+		converted_points += total_point_count(store.lines(static_cast<GeometryStore::ShapeId>(i)));
+	std::vector<Point> per_line, per_shape;
+	per_line.reserve(converted_points);
+	per_shape.reserve(converted_points);
+	start = clock::now();
+	for (std::size_t i = 0; i < converted; ++i) {
+		for (auto&& l : *objects[i]) {
+			LineToPointAdapter lpo{ l };
+			per_line.insert(per_line.end(), lpo.begin(), lpo.end());
+		}
+	}
+	const auto per_line_us = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+	start = clock::now();
+	for (std::size_t i = 0; i < converted; ++i) {
+		const SpanToPointAdapter spo{ store.lines(static_cast<GeometryStore::ShapeId>(i)) };
+		per_shape.insert(per_shape.end(), spo.begin(), spo.end());
+	}
+	const auto per_shape_us = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+	const bool same = std::equal(per_line.begin(), per_line.end(), per_shape.begin(), per_shape.end(),
+		[](const Point& a, const Point& b) { return a.x == b.x && a.y == b.y; });
+	std::cout << "LineToPointAdapter: " << per_line_us.count() << " us, SpanToPointAdapter: " << per_shape_us.count()
+		<< " us (" << per_shape.size() << " points)" << (same ? "" : " (MISMATCH)") << std::endl;
+}
+
+// 大量互相重叠的矩形 (和 test() 里一样的两份相同矩形再加偏移): 逐点写 vs 合并成整字写,
+// 以及第二帧重画相同内容时的脏区域和 flush 写出量
+void benchmark_bitmap_canvas() {
+	using clock = std::chrono::steady_clock;
+
+	std::vector<std::shared_ptr<VectorObject>> scene;
+	for (int i = 0; i < 500; ++i) {
+		scene.push_back(std::make_shared<VectorRectangle>(10 + i % 50, 10 + i % 40, 1500, 1000));
+		scene.push_back(std::make_shared<VectorRectangle>(10 + i % 50, 10 + i % 40, 1500, 1000));
+	}
+	const auto lines = collect_lines(scene);
+
+	BitmapCanvas per_point{2048, 2048};
+	BitmapCanvas spans{2048, 2048};
+
+	auto start = clock::now();
+	for (auto& l : lines)
+		for (auto&& p : LinePoints{ l })
+			per_point.set(p.x, p.y);
+	const auto per_point_us = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+	start = clock::now();
+	for (auto& l : lines) {
+		LinePoints lpo{ l };
+		DrawPoints(spans, lpo.begin(), lpo.end());
+	}
+	const auto spans_us = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+	BitmapCanvas scanlines{2048, 2048};
+	start = clock::now();
+	for (auto& l : lines)
+		draw_line(scanlines, l);
+	const auto scanlines_us = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+	const std::size_t first_flush = spans.flush_pbm("canvas.pbm");
+	for (auto& l : lines) {
+		LinePoints lpo{ l };
+		DrawPoints(spans, lpo.begin(), lpo.end());
+	}
+	const std::size_t redraw_dirty = spans.dirty_rects().size();
+
+	// 再加一个小矩形, 只有它覆盖到的 tile 需要写回
+	VectorRectangle extra{1800, 1800, 100, 100};
+	for (auto&& l : extra) {
+		LinePoints lpo{ l };
+		DrawPoints(spans, lpo.begin(), lpo.end());
+	}
+	const std::size_t extra_dirty = spans.dirty_rects().size();
+	const std::size_t second_flush = spans.flush_pbm("canvas.pbm");
+
+	std::cout << "per point: " << per_point_us.count() << " us, DrawPoints: " << spans_us.count()
+		<< " us, draw_line: " << scanlines_us.count() << " us, " << per_point.count() << " / "
+		<< scanlines.count() << " pixels set" << std::endl;
+	std::cout << "first flush " << first_flush << " bytes, redraw dirty rects " << redraw_dirty
+		<< ", after extra rectangle " << extra_dirty << " dirty rects, second flush "
+		<< second_flush << " bytes" << std::endl;
+}
+
+// 惰性的 LinePoints 边算边画, 整个过程不存储任何点
+void dosomething(BitmapCanvas& dc, const std::vector<std::shared_ptr<VectorObject>>& vectorObjects) {
 	for (auto&& obj : vectorObjects) {
 		for (auto&& line : *obj) {
-			LineToPointAdapter lpo{ line };
+			const LinePoints lpo{ line };
 			DrawPoints(dc, lpo.begin(), lpo.end());
 		}
 	};
@@ -98,18 +420,17 @@ void test() {
 		std::make_shared<VectorRectangle>(10, 10, 100, 100)
 	};
 
-	std::vector<Point> points;
+	BitmapCanvas dc{128, 128};
 
+	// 惰性点序列的迭代器直接喂给 DrawPoints, 没有中间的点数组
 	for (auto&& o : VectorRectangles) {
 		for (auto&& l : *o) {
-			LineToPointAdapter lpo{ l };
-			for (auto&& p : lpo) {
-				points.push_back(p);
-			}
+			const LinePoints lpo{ l };
+			DrawPoints(dc, lpo.begin(), lpo.end());
 		}
 	}
 
-	DrawPoints(dc, points.begin(), points.end());
+	dc.flush_pbm("test.pbm");
 }
 
 
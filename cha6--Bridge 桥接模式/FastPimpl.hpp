@@ -0,0 +1,70 @@
+#ifndef FASTPIMPL_HPP
+#define FASTPIMPL_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// 把实现对象直接放在外层对象内部的对齐存储里的 Pimpl.
+//
+// 头文件里只需要写出实现的大小和对齐, 不需要实现类的定义, 所以依然隐藏了实现细节;
+// 但不再有堆分配, 访问也少了一次指针跳转. 大小和对齐在实现类完整的地方(析构函数里)做编译期检查.
+// 所有成员函数都只能在实现类完整的翻译单元里实例化, 所以外层类的构造/析构/拷贝/移动必须在 .cpp 中定义
+template <typename T, std::size_t Size, std::size_t Alignment>
+class FastPimpl {
+private:
+	alignas(Alignment) unsigned char storage_[Size];
+
+	T* ptr() noexcept { return std::launder(reinterpret_cast<T*>(storage_)); }
+	const T* ptr() const noexcept { return std::launder(reinterpret_cast<const T*>(storage_)); }
+
+	template <std::size_t ActualSize, std::size_t ActualAlignment>
+	static void validate() noexcept {
+		static_assert(Size >= ActualSize, "FastPimpl: Size is too small for the implementation");
+		static_assert(Alignment % ActualAlignment == 0, "FastPimpl: Alignment is not a multiple of the implementation's");
+	}
+
+public:
+	FastPimpl() {
+		new (storage_) T();
+	}
+
+	// 单个 FastPimpl 参数要走下面的拷贝/移动构造, 否则拷贝非 const 左值时会把 FastPimpl 本身转发给 T
+	template <typename... Args,
+	          typename = std::enable_if_t<(sizeof...(Args) > 0) &&
+	                                      !(sizeof...(Args) == 1 && (std::is_same_v<std::decay_t<Args>, FastPimpl> && ...))>>
+	explicit FastPimpl(Args&&... args) {
+		new (storage_) T(std::forward<Args>(args)...);
+	}
+
+	FastPimpl(const FastPimpl& other) {
+		new (storage_) T(*other);
+	}
+
+	FastPimpl(FastPimpl&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+		new (storage_) T(std::move(*other));
+	}
+
+	FastPimpl& operator=(const FastPimpl& other) {
+		*ptr() = *other;
+		return *this;
+	}
+
+	FastPimpl& operator=(FastPimpl&& other) noexcept(std::is_nothrow_move_assignable_v<T>) {
+		*ptr() = std::move(*other);
+		return *this;
+	}
+
+	~FastPimpl() noexcept {
+		validate<sizeof(T), alignof(T)>();
+		ptr()->~T();
+	}
+
+	T* operator->() noexcept { return ptr(); }
+	const T* operator->() const noexcept { return ptr(); }
+	T& operator*() noexcept { return *ptr(); }
+	const T& operator*() const noexcept { return *ptr(); }
+};
+
+#endif //FASTPIMPL_HPP
@@ -6,13 +6,14 @@ public:
 	static void greet(const Person* p) ;
 };
 
-Person::Person() : impl_{new PersonImpl} {
+Person::Person() = default;
 
-}
+Person::~Person() = default;
 
-Person::~Person() {
-	delete impl_;
-}
+Person::Person(const Person& other) = default;
+Person::Person(Person&& other) noexcept = default;
+Person& Person::operator=(const Person& other) = default;
+Person& Person::operator=(Person&& other) noexcept = default;
 
 void Person::greet() const {
 	PersonImpl::greet(this);
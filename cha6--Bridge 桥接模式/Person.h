@@ -3,16 +3,24 @@
 
 #include <string>
 
+#include "FastPimpl.hpp"
+
 struct Person {
 	class PersonImpl;
 
 	std::string name_;
-	PersonImpl* impl_{};
+	// PersonImpl 直接放在 Person 对象里, 大小和对齐在 Person.cpp 中检查
+	FastPimpl<PersonImpl, 8, 8> impl_;
 
 	void greet() const;
 
 	Person();
 	~Person();
+
+	Person(const Person& other);
+	Person(Person&& other) noexcept;
+	Person& operator=(const Person& other);
+	Person& operator=(Person&& other) noexcept;
 };
 
 #endif //PERSON_H
@@ -0,0 +1,157 @@
+#ifndef PIXELBUFFER_HPP
+#define PIXELBUFFER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// 闭区间 [x0, x1] x [y0, y1] 的裁剪矩形
+struct ClipRect {
+	int x0;
+	int y0;
+	int x1;
+	int y1;
+};
+
+// 0x00RRGGBB 像素缓冲
+class PixelBuffer {
+private:
+	int width_;
+	int height_;
+	std::vector<std::uint32_t> pixels_;
+
+public:
+	PixelBuffer(const int width, const int height)
+		: width_{width}, height_{height}, pixels_(static_cast<std::size_t>(width) * height, 0) {}
+
+	[[nodiscard]] int width() const { return width_; }
+	[[nodiscard]] int height() const { return height_; }
+	[[nodiscard]] ClipRect bounds() const { return ClipRect{0, 0, width_ - 1, height_ - 1}; }
+	[[nodiscard]] const std::vector<std::uint32_t>& pixels() const { return pixels_; }
+
+	[[nodiscard]] std::uint32_t get(const int x, const int y) const {
+		return pixels_[static_cast<std::size_t>(y) * width_ + x];
+	}
+
+	void clear(const std::uint32_t color = 0) {
+		std::fill(pixels_.begin(), pixels_.end(), color);
+	}
+
+	void set(const int x, const int y, const std::uint32_t color, const ClipRect& clip) {
+		if (x >= clip.x0 && x <= clip.x1 && y >= clip.y0 && y <= clip.y1)
+			pixels_[static_cast<std::size_t>(y) * width_ + x] = color;
+	}
+
+	// 水平填充 [x0, x1], 先裁剪再用 SSE2 一次写 4 个像素
+	void fill_span(const int y, int x0, int x1, const std::uint32_t color, const ClipRect& clip) {
+		if (y < clip.y0 || y > clip.y1)
+			return;
+		x0 = std::max(x0, clip.x0);
+		x1 = std::min(x1, clip.x1);
+		if (x0 > x1)
+			return;
+
+		std::uint32_t* p = pixels_.data() + static_cast<std::size_t>(y) * width_ + x0;
+		std::size_t n = static_cast<std::size_t>(x1 - x0) + 1;
+#ifdef __SSE2__
+		const __m128i value = _mm_set1_epi32(static_cast<int>(color));
+		for (; n >= 4; n -= 4, p += 4)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(p), value);
+#endif
+		for (; n > 0; --n)
+			*p++ = color;
+	}
+
+	// 二进制 PPM (P6)
+	void write_ppm(const std::string& path) const {
+		std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+		if (!ofs)
+			throw std::runtime_error("Cannot write " + path);
+		ofs << "P6\n" << width_ << " " << height_ << "\n255\n";
+		std::vector<char> row(static_cast<std::size_t>(width_) * 3);
+		for (int y = 0; y < height_; ++y) {
+			for (int x = 0; x < width_; ++x) {
+				const std::uint32_t c = get(x, y);
+				row[x * 3 + 0] = static_cast<char>(c >> 16 & 0xFF);
+				row[x * 3 + 1] = static_cast<char>(c >> 8 & 0xFF);
+				row[x * 3 + 2] = static_cast<char>(c & 0xFF);
+			}
+			ofs.write(row.data(), static_cast<std::streamsize>(row.size()));
+		}
+	}
+};
+
+// 中点画圆法. 对每个生成的 (x, y) 八分点调用 plot(x, y)
+template <typename Plot>
+void midpoint_circle(const int radius, Plot plot) {
+	int x = radius;
+	int y = 0;
+	int err = 1 - radius;
+	while (x >= y) {
+		plot(x, y);
+		++y;
+		if (err < 0) {
+			err += 2 * y + 1;
+		} else {
+			--x;
+			err += 2 * (y - x) + 1;
+		}
+	}
+}
+
+// 圆的光栅化, 复用每行半宽的临时表
+class CircleRasterizer {
+private:
+	std::vector<int> half_width_;
+
+public:
+	// 轮廓: 八个对称点, 逐点裁剪
+	void outline(PixelBuffer& buffer, const int cx, const int cy, const int radius,
+	             const std::uint32_t color, const ClipRect& clip) {
+		if (radius < 0 || cx + radius < clip.x0 || cx - radius > clip.x1 ||
+			cy + radius < clip.y0 || cy - radius > clip.y1)
+			return;
+		midpoint_circle(radius, [&](const int x, const int y) {
+			buffer.set(cx + x, cy + y, color, clip);
+			buffer.set(cx - x, cy + y, color, clip);
+			buffer.set(cx + x, cy - y, color, clip);
+			buffer.set(cx - x, cy - y, color, clip);
+			buffer.set(cx + y, cy + x, color, clip);
+			buffer.set(cx - y, cy + x, color, clip);
+			buffer.set(cx + y, cy - x, color, clip);
+			buffer.set(cx - y, cy - x, color, clip);
+		});
+	}
+
+	// 实心: 由中点法的轮廓点得到每行 |dy| 的半宽, 再逐行做水平填充; 每行只写一次
+	void fill(PixelBuffer& buffer, const int cx, const int cy, const int radius,
+	          const std::uint32_t color, const ClipRect& clip) {
+		if (radius < 0 || cx + radius < clip.x0 || cx - radius > clip.x1 ||
+			cy + radius < clip.y0 || cy - radius > clip.y1)
+			return;
+
+		half_width_.assign(static_cast<std::size_t>(radius) + 1, 0);
+		midpoint_circle(radius, [&](const int x, const int y) {
+			half_width_[y] = std::max(half_width_[y], x);
+			half_width_[x] = std::max(half_width_[x], y);
+		});
+
+		// 只遍历落在裁剪范围内的行
+		const int first = std::max(-radius, clip.y0 - cy);
+		const int last = std::min(radius, clip.y1 - cy);
+		for (int dy = first; dy <= last; ++dy) {
+			const int half = half_width_[dy < 0 ? -dy : dy];
+			buffer.fill_span(cy + dy, cx - half, cx + half, color, clip);
+		}
+	}
+};
+
+#endif //PIXELBUFFER_HPP
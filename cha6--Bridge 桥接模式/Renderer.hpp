@@ -0,0 +1,25 @@
+#ifndef RENDERER_HPP
+#define RENDERER_HPP
+
+#include <cstddef>
+
+struct CircleData {
+	float x;
+	float y;
+	float radius;
+};
+
+// 图形渲染所需实现的接口
+struct Renderer {
+	virtual ~Renderer() = default;
+
+	virtual void render_circle(float x, float y, float radius) = 0;
+
+	// 一次提交一批圆, 整批只有一次虚调用; 默认逐个转发给 render_circle
+	virtual void render_circles(const CircleData* circles, const std::size_t count) {
+		for (std::size_t i = 0; i < count; ++i)
+			render_circle(circles[i].x, circles[i].y, circles[i].radius);
+	}
+};
+
+#endif //RENDERER_HPP
@@ -0,0 +1,204 @@
+#ifndef WORKSTEALINGPOOL_HPP
+#define WORKSTEALINGPOOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 每个工作线程一个任务队列: 自己从队尾取, 空了就从别人的队头偷.
+// 任务大小不均匀时(比如有的 tile 或输出块计算量更大)空闲线程会自动去分担.
+// 除了阻塞的 parallel_for, 还可以用 TaskGroup 在任务里继续派生子任务 (fork-join)
+//
+// 每章是独立的 CMake 工程, 所以 cha5/cha6/cha7 各带一份本文件, 三份逐字节相同;
+// 修改时改一份再复制到其他章节 (cmp 应当没有输出)
+class WorkStealingPool {
+private:
+	struct alignas(64) Queue {
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	std::vector<std::thread> workers_;
+	std::unique_ptr<Queue[]> queues_;
+	std::size_t queue_count_;
+
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable done_;
+	std::atomic<std::size_t> queued_{0};     // 还在队列里的任务
+	std::atomic<std::size_t> unfinished_{0}; // 还没执行完的任务
+	bool stopping_{false};
+	std::atomic<std::size_t> next_queue_{0}; // 外部线程提交任务时轮流放入各队列
+
+	// 当前线程如果是本池的工作线程, 记下它的队列
+	static std::size_t& worker_index() {
+		thread_local std::size_t index = 0;
+		return index;
+	}
+
+	static const WorkStealingPool*& worker_pool() {
+		thread_local const WorkStealingPool* pool = nullptr;
+		return pool;
+	}
+
+	[[nodiscard]] std::size_t local_queue() {
+		if (worker_pool() == this)
+			return worker_index();
+		return next_queue_.fetch_add(1, std::memory_order_relaxed) % queue_count_;
+	}
+
+	bool try_run(const std::size_t self) {
+		std::function<void()> task;
+		for (std::size_t k = 0; k < queue_count_ && !task; ++k) {
+			Queue& queue = queues_[(self + k) % queue_count_];
+			std::lock_guard<std::mutex> lock{queue.mutex};
+			if (queue.tasks.empty())
+				continue;
+			if (k == 0) {
+				task = std::move(queue.tasks.back());
+				queue.tasks.pop_back();
+			} else {
+				task = std::move(queue.tasks.front());
+				queue.tasks.pop_front();
+			}
+		}
+		if (!task)
+			return false;
+
+		--queued_;
+		task();
+		if (--unfinished_ == 0) {
+			std::lock_guard<std::mutex> lock{mutex_};
+			done_.notify_all();
+		}
+		return true;
+	}
+
+	void run(const std::size_t self) {
+		worker_pool() = this;
+		worker_index() = self;
+		for (;;) {
+			if (try_run(self))
+				continue;
+			std::unique_lock<std::mutex> lock{mutex_};
+			wake_.wait(lock, [this] { return stopping_ || queued_.load() > 0; });
+			if (stopping_ && queued_.load() == 0)
+				return;
+		}
+	}
+
+public:
+	explicit WorkStealingPool(const std::size_t thread_count = std::thread::hardware_concurrency())
+		: queue_count_{std::max<std::size_t>(1, thread_count)} {
+		queues_ = std::make_unique<Queue[]>(queue_count_);
+		workers_.reserve(queue_count_);
+		for (std::size_t i = 0; i < queue_count_; ++i)
+			workers_.emplace_back([this, i] { run(i); });
+	}
+
+	WorkStealingPool(const WorkStealingPool&) = delete;
+	WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+	~WorkStealingPool() {
+		{
+			std::lock_guard<std::mutex> lock{mutex_};
+			stopping_ = true;
+		}
+		wake_.notify_all();
+		for (auto& worker : workers_)
+			worker.join();
+	}
+
+	[[nodiscard]] std::size_t size() const { return queue_count_; }
+
+	// 对 [0, count) 的每个下标执行 f, 全部完成后才返回
+	template <typename F>
+	void parallel_for(const std::size_t count, F f) {
+		if (count == 0)
+			return;
+		{
+			std::lock_guard<std::mutex> lock{mutex_};
+			unfinished_ += count;
+			queued_ += count;
+		}
+		for (std::size_t i = 0; i < count; ++i) {
+			Queue& queue = queues_[i % queue_count_];
+			std::lock_guard<std::mutex> lock{queue.mutex};
+			queue.tasks.emplace_back([&f, i] { f(i); });
+		}
+		wake_.notify_all();
+
+		std::unique_lock<std::mutex> lock{mutex_};
+		done_.wait(lock, [this] { return unfinished_.load() == 0; });
+	}
+
+	// 提交一个任务; 工作线程提交的任务放进自己的队列, 优先由自己执行, 空闲的线程可以偷走
+	template <typename F>
+	void submit(F f) {
+		{
+			std::lock_guard<std::mutex> lock{mutex_};
+			++unfinished_;
+			++queued_;
+		}
+		{
+			Queue& queue = queues_[local_queue()];
+			std::lock_guard<std::mutex> lock{queue.mutex};
+			queue.tasks.emplace_back(std::move(f));
+		}
+		wake_.notify_one();
+	}
+
+	// 在当前线程执行一个排队的任务, 没有任务时返回 false
+	bool help() {
+		return try_run(worker_pool() == this ? worker_index() : 0);
+	}
+
+	// 一组派生出的任务: run 提交, wait 在等待期间帮忙执行池里的任务, 所以在任务内部等待也不会死锁.
+	// 没有可帮忙的任务时 (剩下的都在别的线程上执行) 睡在池的 wake_ 上, 直到本组完成或池里来了新任务
+	class TaskGroup {
+	private:
+		WorkStealingPool& pool_;
+		std::atomic<std::size_t> pending_{0};
+
+	public:
+		explicit TaskGroup(WorkStealingPool& pool) : pool_{pool} {}
+
+		TaskGroup(const TaskGroup&) = delete;
+		TaskGroup& operator=(const TaskGroup&) = delete;
+
+		~TaskGroup() { wait(); }
+
+		template <typename F>
+		void run(F f) {
+			pending_.fetch_add(1, std::memory_order_relaxed);
+			// 计数归零后 wait 可能立刻返回并销毁本组, 之后只能用捕获的 pool
+			pool_.submit([this, &pool = pool_, f = std::move(f)]() mutable {
+				f();
+				if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+					std::lock_guard<std::mutex> lock{pool.mutex_};
+					pool.wake_.notify_all();
+				}
+			});
+		}
+
+		void wait() {
+			while (pending_.load(std::memory_order_acquire) != 0) {
+				if (pool_.help())
+					continue;
+				std::unique_lock<std::mutex> lock{pool_.mutex_};
+				pool_.wake_.wait(lock, [this] {
+					return pending_.load(std::memory_order_acquire) == 0 || pool_.queued_.load() > 0;
+				});
+			}
+		}
+	};
+};
+
+#endif //WORKSTEALINGPOOL_HPP
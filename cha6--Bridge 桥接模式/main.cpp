@@ -1,11 +1,20 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <memory>
+#include <utility>
+#include <vector>
 
-// 图形渲染所需实现的接口
-struct Renderer {
-	virtual ~Renderer() = default;
-
-	virtual void render_circle(float x, float y, float radius) = 0;
-};
+#include "Person.h"
+#include "PixelBuffer.hpp"
+#include "Renderer.hpp"
+#include "WorkStealingPool.hpp"
 
 // 矢量实现渲染
 struct VectorRenderer final : Renderer {
@@ -14,10 +23,143 @@ struct VectorRenderer final : Renderer {
 	}
 };
 
-// 栅格实现渲染
+// 栅格实现渲染: 真正把圆画进自己持有的像素缓冲, 超出画布的部分被裁掉
 struct RasterRenderer final : Renderer {
+	enum class Style {
+		filled,
+		outlined,
+	};
+
+private:
+	PixelBuffer buffer_;
+	CircleRasterizer rasterizer_;
+	Style style_{Style::filled};
+	std::uint32_t color_{0xFFFFFF};
+
+	void draw(const float x, const float y, const float radius) {
+		const int cx = static_cast<int>(std::lround(x));
+		const int cy = static_cast<int>(std::lround(y));
+		const int r = static_cast<int>(std::lround(radius));
+		if (style_ == Style::filled)
+			rasterizer_.fill(buffer_, cx, cy, r, color_, buffer_.bounds());
+		else
+			rasterizer_.outline(buffer_, cx, cy, r, color_, buffer_.bounds());
+	}
+
+public:
+	explicit RasterRenderer(const int width = 640, const int height = 480) : buffer_{width, height} {}
+
+	void set_style(const Style style) { style_ = style; }
+	void set_color(const std::uint32_t color) { color_ = color; }
+
+	[[nodiscard]] PixelBuffer& buffer() { return buffer_; }
+
+	void render_circle(float x, float y, float radius) override {
+		draw(x, y, radius);
+	}
+
+	void render_circles(const CircleData* circles, const std::size_t count) override {
+		for (std::size_t i = 0; i < count; ++i)
+			draw(circles[i].x, circles[i].y, circles[i].radius);
+	}
+};
+
+// 分块并行的栅格实现: render_circle 只把圆连同当时的样式和颜色记入队列,
+// flush 时按包围盒把圆分到覆盖它的各个 tile, 每个 tile 一个任务交给线程池,
+// 任务用 tile 自己的裁剪矩形光栅化, tile 互不重叠, 写像素缓冲不需要加锁.
+// 每个 tile 内按提交顺序绘制, 结果与 RasterRenderer 逐像素相同
+class TiledRasterRenderer final : public Renderer {
+private:
+	struct QueuedCircle {
+		int cx;
+		int cy;
+		int radius;
+		std::uint32_t color;
+		RasterRenderer::Style style;
+	};
+
+	WorkStealingPool& pool_;
+	PixelBuffer buffer_;
+	int tile_size_;
+	int tiles_x_;
+	int tiles_y_;
+	RasterRenderer::Style style_{RasterRenderer::Style::filled};
+	std::uint32_t color_{0xFFFFFF};
+
+	std::vector<QueuedCircle> queue_;
+	std::vector<std::vector<std::uint32_t>> bins_;
+	// 每个 tile 一个, 半宽表的临时存储在任务之间不共享
+	std::vector<CircleRasterizer> rasterizers_;
+
+	void enqueue(const float x, const float y, const float radius) {
+		const int r = static_cast<int>(std::lround(radius));
+		if (r < 0)
+			return;
+		queue_.push_back(QueuedCircle{static_cast<int>(std::lround(x)), static_cast<int>(std::lround(y)), r, color_, style_});
+	}
+
+	void bin() {
+		for (auto& bin : bins_)
+			bin.clear();
+		for (std::uint32_t i = 0; i < queue_.size(); ++i) {
+			const QueuedCircle& c = queue_[i];
+			const int x0 = std::max(0, c.cx - c.radius);
+			const int x1 = std::min(buffer_.width() - 1, c.cx + c.radius);
+			const int y0 = std::max(0, c.cy - c.radius);
+			const int y1 = std::min(buffer_.height() - 1, c.cy + c.radius);
+			if (x0 > x1 || y0 > y1)
+				continue;
+			for (int ty = y0 / tile_size_; ty <= y1 / tile_size_; ++ty)
+				for (int tx = x0 / tile_size_; tx <= x1 / tile_size_; ++tx)
+					bins_[static_cast<std::size_t>(ty) * tiles_x_ + tx].push_back(i);
+		}
+	}
+
+public:
+	TiledRasterRenderer(WorkStealingPool& pool, const int width = 640, const int height = 480, const int tile_size = 128)
+		: pool_{pool}, buffer_{width, height}, tile_size_{std::max(1, tile_size)},
+		  tiles_x_{(width + tile_size_ - 1) / tile_size_}, tiles_y_{(height + tile_size_ - 1) / tile_size_},
+		  bins_(static_cast<std::size_t>(tiles_x_) * tiles_y_),
+		  rasterizers_(static_cast<std::size_t>(tiles_x_) * tiles_y_) {}
+
+	// 样式和颜色在提交时记录, 之后修改不影响已入队的圆
+	void set_style(const RasterRenderer::Style style) { style_ = style; }
+	void set_color(const std::uint32_t color) { color_ = color; }
+
+	// 只包含已经 flush 的圆
+	[[nodiscard]] PixelBuffer& buffer() { return buffer_; }
+	[[nodiscard]] std::size_t pending() const { return queue_.size(); }
+
 	void render_circle(float x, float y, float radius) override {
-		std::cout << "Drawing a vector circle of radius." << radius << std::endl;
+		enqueue(x, y, radius);
+	}
+
+	void render_circles(const CircleData* circles, const std::size_t count) override {
+		queue_.reserve(queue_.size() + count);
+		for (std::size_t i = 0; i < count; ++i)
+			enqueue(circles[i].x, circles[i].y, circles[i].radius);
+	}
+
+	// 帧边界: 把队列里的圆全部画进像素缓冲, 返回时所有 tile 都已写完, 可以安全读取 buffer()
+	void flush() {
+		if (queue_.empty())
+			return;
+		bin();
+		pool_.parallel_for(bins_.size(), [&](const std::size_t tile) {
+			const int left = static_cast<int>(tile % tiles_x_) * tile_size_;
+			const int top = static_cast<int>(tile / tiles_x_) * tile_size_;
+			const ClipRect clip{left, top,
+				std::min(left + tile_size_, buffer_.width()) - 1, std::min(top + tile_size_, buffer_.height()) - 1};
+			CircleRasterizer& rasterizer = rasterizers_[tile];
+			for (const std::uint32_t i : bins_[tile]) {
+				const QueuedCircle& c = queue_[i];
+				if (c.style == RasterRenderer::Style::filled)
+					rasterizer.fill(buffer_, c.cx, c.cy, c.radius, c.color, clip);
+				else
+					rasterizer.outline(buffer_, c.cx, c.cy, c.radius, c.color, clip);
+			}
+		});
+		queue_.clear();
 	}
 };
 
@@ -29,6 +171,8 @@ protected:
 public:
 	virtual ~Shape() = default;
 
+	[[nodiscard]] Renderer& renderer() const { return renderer_; }
+
 	virtual void draw() = 0;
 	virtual void resize(const float& factor) = 0;
 };
@@ -45,8 +189,122 @@ struct Circle final : Shape {
 		radius_ *= factor;
 	}
 	Circle(Renderer& renderer, const float& x, const float& y, const float& radius)
-		: Shape{renderer_}, x_{x}, y_{y}, radius_{radius} {
+		: Shape{renderer}, x_{x}, y_{y}, radius_{radius} {
+
+	}
+
+	[[nodiscard]] CircleData data() const {
+		return CircleData{x_, y_, radius_};
+	}
+};
+
+// 收集一帧里要画的圆, 按各自的 Renderer 分组, flush 时每组一次 render_circles.
+// add 是非虚调用, 一帧的虚调用次数只和 Renderer 的个数有关, 与圆的个数无关
+class ShapeBatch {
+private:
+	std::vector<std::pair<Renderer*, std::vector<CircleData>>> groups_;
+	// 连续提交同一个 Renderer 时直接追加, 不用再查找分组
+	Renderer* current_renderer_{nullptr};
+	std::vector<CircleData>* current_{nullptr};
+
+	void switch_to(Renderer& renderer) {
+		current_renderer_ = &renderer;
+		for (auto& [r, circles] : groups_) {
+			if (r == &renderer) {
+				current_ = &circles;
+				return;
+			}
+		}
+		groups_.emplace_back(&renderer, std::vector<CircleData>{});
+		current_ = &groups_.back().second;
+	}
+
+public:
+	void add(const Circle& circle) {
+		if (&circle.renderer() != current_renderer_)
+			switch_to(circle.renderer());
+		current_->push_back(circle.data());
+	}
+
+	void flush() {
+		for (auto& [renderer, circles] : groups_) {
+			if (circles.empty())
+				continue;
+			renderer->render_circles(circles.data(), circles.size());
+			circles.clear(); // 保留容量, 下一帧不必重新分配
+		}
+	}
+};
+
+// 编译期桥接: 实现类型作为模板参数, 调用目标在编译期确定, render_circle 可以被内联.
+// RendererT 只需要提供 render_circle(float, float, float), 不必继承 Renderer
+namespace static_dispatch {
+
+template <typename RendererT>
+struct Circle {
+	RendererT& renderer_;
+	float x_;
+	float y_;
+	float radius_;
+
+	Circle(RendererT& renderer, const float& x, const float& y, const float& radius)
+		: renderer_{renderer}, x_{x}, y_{y}, radius_{radius} {
+
+	}
+
+	void draw() {
+		renderer_.render_circle(x_, y_, radius_);
+	}
+	void resize(const float& factor) {
+		radius_ *= factor;
+	}
+
+	[[nodiscard]] RendererT& renderer() const { return renderer_; }
+
+	[[nodiscard]] CircleData data() const {
+		return CircleData{x_, y_, radius_};
+	}
+};
+
+// 把静态绑定的图形包装成动态的 Shape, 以便和普通图形放在同一个场景里.
+// 外层仍是一次虚 draw(), 但内部对实现的调用是静态的
+template <typename StaticShape>
+struct ShapeAdapter final : ::Shape {
+	StaticShape shape_;
+
+	explicit ShapeAdapter(const StaticShape& shape) : ::Shape{shape.renderer()}, shape_{shape} {
+		static_assert(std::is_base_of_v<Renderer, std::remove_reference_t<decltype(shape.renderer())>>,
+			"ShapeAdapter requires the static renderer to also be a Renderer");
+	}
+
+	void draw() override {
+		shape_.draw();
+	}
+	void resize(const float& factor) override {
+		shape_.resize(factor);
+	}
+};
+
+} // namespace static_dispatch
+
+// 不输出任何东西, 只累加面积, 用来测量调用开销
+struct CountingRenderer final : Renderer {
+	double total_area{0};
 
+	void render_circle(float, float, float radius) override {
+		total_area += 3.14159265 * radius * radius;
+	}
+
+	// 整批数据连续存放, 可以拆成几条独立的累加链, 不必等上一次加法完成
+	void render_circles(const CircleData* circles, const std::size_t count) override {
+		double partial[4] = {0, 0, 0, 0};
+		std::size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+			for (std::size_t k = 0; k < 4; ++k)
+				partial[k] += circles[i + k].radius * circles[i + k].radius;
+		for (; i < count; ++i)
+			partial[0] += circles[i].radius * circles[i].radius;
+		total_area += 3.14159265 * (partial[0] + partial[1] + partial[2] + partial[3]);
 	}
 };
 
@@ -58,10 +316,213 @@ void test() {
 	raster_circle.draw();
 }
 
+// 1M 个圆: 每个圆一次虚 draw() + 一次虚 render_circle, 对比先批量收集再每组一次 render_circles
+void benchmark_batch_rendering() {
+	using clock = std::chrono::steady_clock;
+
+	CountingRenderer renderer;
+	std::vector<std::unique_ptr<Shape>> shapes;
+	std::vector<Circle> circles;
+	for (int i = 0; i < 1'000'000; ++i) {
+		shapes.push_back(std::make_unique<Circle>(renderer, i % 640, i % 480, 1 + i % 16));
+		circles.emplace_back(renderer, i % 640, i % 480, 1 + i % 16);
+	}
+
+	constexpr int frames = 10;
+
+	auto start = clock::now();
+	for (int frame = 0; frame < frames; ++frame)
+		for (auto& shape : shapes)
+			shape->draw();
+	const auto per_shape = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+	// 第一帧之后批次的缓冲区容量被复用, 稳定状态下没有分配
+	ShapeBatch batch;
+	start = clock::now();
+	for (int frame = 0; frame < frames; ++frame) {
+		for (auto& circle : circles)
+			batch.add(circle);
+		batch.flush();
+	}
+	const auto batched = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+	std::cout << "per shape: " << per_shape.count() / frames << " us/frame, batched: " << batched.count() / frames
+		<< " us/frame (area " << renderer.total_area << ")" << std::endl;
+}
+
+// 不同半径下每秒能画多少个圆, 最后把一帧写成 circles.ppm 以便目视检查
+void benchmark_raster_renderer() {
+	using clock = std::chrono::steady_clock;
+
+	RasterRenderer renderer{1920, 1080};
+	std::mt19937 rng{11};
+	std::uniform_real_distribution<float> px{-50, 1970};
+	std::uniform_real_distribution<float> py{-50, 1130};
+
+	for (const float radius : {1.0f, 4.0f, 16.0f, 64.0f, 256.0f}) {
+		for (const auto style : {RasterRenderer::Style::filled, RasterRenderer::Style::outlined}) {
+			renderer.set_style(style);
+			const int count = static_cast<int>(2'000'000 / (radius + 4));
+			std::vector<CircleData> circles(count);
+			for (auto& c : circles)
+				c = CircleData{px(rng), py(rng), radius};
+
+			const auto start = clock::now();
+			renderer.render_circles(circles.data(), circles.size());
+			const auto elapsed = std::chrono::duration<double>(clock::now() - start).count();
+			std::cout << "radius " << radius << (style == RasterRenderer::Style::filled ? " filled:   " : " outlined: ")
+				<< static_cast<long long>(count / elapsed) << " circles/s" << std::endl;
+		}
+	}
+
+	renderer.buffer().clear();
+	renderer.set_style(RasterRenderer::Style::filled);
+	renderer.set_color(0x3060C0);
+	renderer.render_circle(960, 540, 400);
+	renderer.render_circle(-100, 100, 300); // 跨过左边界, 检查裁剪
+	renderer.set_style(RasterRenderer::Style::outlined);
+	renderer.set_color(0xFFD040);
+	for (int r = 20; r < 400; r += 40)
+		renderer.render_circle(960, 540, static_cast<float>(r));
+	renderer.buffer().write_ppm("circles.ppm");
+}
+
+// 构造并析构 5M 个 Person: 实现对象内联在 Person 里, 对比每个对象一次 new/delete 的传统 Pimpl
+void benchmark_person_pimpl() {
+	using clock = std::chrono::steady_clock;
+
+	// 与改动前的 Person 布局相同: 名字 + 指向堆上实现的指针
+	struct HeapPimplPerson {
+		struct Impl {};
+
+		std::string name_;
+		std::unique_ptr<Impl> impl_{std::make_unique<Impl>()};
+	};
+
+	constexpr int count = 5'000'000;
+	constexpr int batch = 1000;
+
+	std::vector<HeapPimplPerson> heap_people;
+	heap_people.reserve(batch);
+	auto start = clock::now();
+	for (int i = 0; i < count; i += batch) {
+		for (int j = 0; j < batch; ++j)
+			heap_people.emplace_back();
+		heap_people.clear();
+	}
+	const auto heap = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+	std::vector<Person> people;
+	people.reserve(batch);
+	start = clock::now();
+	for (int i = 0; i < count; i += batch) {
+		for (int j = 0; j < batch; ++j)
+			people.emplace_back();
+		people.clear();
+	}
+	const auto fast = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+	std::cout << "heap pimpl: " << heap.count() << " us, fast pimpl: " << fast.count() << " us ("
+		<< sizeof(HeapPimplPerson) << " vs " << sizeof(Person) << " bytes)" << std::endl;
+}
+
+// 5M 次 draw: 经 Shape 的虚 draw() 加 Renderer 的虚 render_circle, 对比 Circle<CountingRenderer> 的静态调用,
+// 以及通过 ShapeAdapter 混在同一个动态场景里的情况
+void benchmark_static_dispatch() {
+	using clock = std::chrono::steady_clock;
+
+	constexpr int count = 1'000'000;
+	constexpr int frames = 5;
+
+	CountingRenderer dynamic_renderer;
+	std::vector<std::unique_ptr<Shape>> dynamic_shapes;
+	for (int i = 0; i < count; ++i)
+		dynamic_shapes.push_back(std::make_unique<Circle>(dynamic_renderer, i % 640, i % 480, 1 + i % 16));
+
+	CountingRenderer static_renderer;
+	std::vector<static_dispatch::Circle<CountingRenderer>> static_shapes;
+	static_shapes.reserve(count);
+	for (int i = 0; i < count; ++i)
+		static_shapes.emplace_back(static_renderer, i % 640, i % 480, 1 + i % 16);
 
+	// 一半动态一半静态的混合场景
+	CountingRenderer mixed_renderer;
+	std::vector<std::unique_ptr<Shape>> mixed_shapes;
+	for (int i = 0; i < count; ++i) {
+		if (i % 2 == 0)
+			mixed_shapes.push_back(std::make_unique<Circle>(mixed_renderer, i % 640, i % 480, 1 + i % 16));
+		else
+			mixed_shapes.push_back(std::make_unique<static_dispatch::ShapeAdapter<static_dispatch::Circle<CountingRenderer>>>(
+				static_dispatch::Circle<CountingRenderer>{mixed_renderer, static_cast<float>(i % 640), static_cast<float>(i % 480), static_cast<float>(1 + i % 16)}));
+	}
+
+	auto start = clock::now();
+	for (int frame = 0; frame < frames; ++frame)
+		for (auto& shape : dynamic_shapes)
+			shape->draw();
+	const auto dynamic = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
 
+	start = clock::now();
+	for (int frame = 0; frame < frames; ++frame)
+		for (auto& shape : static_shapes)
+			shape.draw();
+	const auto static_ = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
 
+	start = clock::now();
+	for (int frame = 0; frame < frames; ++frame)
+		for (auto& shape : mixed_shapes)
+			shape->draw();
+	const auto mixed = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+	std::cout << "dynamic: " << dynamic.count() / frames << " us/frame, static: " << static_.count() / frames
+		<< " us/frame, mixed: " << mixed.count() / frames << " us/frame (area "
+		<< dynamic_renderer.total_area << " / " << static_renderer.total_area << " / " << mixed_renderer.total_area
+		<< ")" << std::endl;
+}
 
+// 同一帧分别用 RasterRenderer 和不同线程数的 TiledRasterRenderer 画, 检查结果一致并比较帧时间
+void benchmark_tiled_raster_renderer() {
+	using clock = std::chrono::steady_clock;
 
+	constexpr int width = 1920;
+	constexpr int height = 1080;
+	std::mt19937 rng{17};
+	std::uniform_real_distribution<float> px{-50, width + 50};
+	std::uniform_real_distribution<float> py{-50, height + 50};
+	std::uniform_real_distribution<float> pr{1, 64};
+	std::vector<CircleData> circles(200'000);
+	for (auto& c : circles)
+		c = CircleData{px(rng), py(rng), pr(rng)};
 
+	// 一半实心一半轮廓, 颜色随提交变化, 检查每个圆的样式是否随队列保存
+	auto submit = [&](auto& renderer) {
+		const std::size_t half = circles.size() / 2;
+		renderer.set_style(RasterRenderer::Style::filled);
+		renderer.set_color(0x3060C0);
+		renderer.render_circles(circles.data(), half);
+		renderer.set_style(RasterRenderer::Style::outlined);
+		renderer.set_color(0xFFD040);
+		renderer.render_circles(circles.data() + half, circles.size() - half);
+	};
 
+	RasterRenderer serial{width, height};
+	auto start = clock::now();
+	submit(serial);
+	const auto serial_time = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+	std::cout << "serial: " << serial_time.count() << " us/frame" << std::endl;
+
+	const std::size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+	for (std::size_t threads = 1; threads <= max_threads; threads *= 2) {
+		WorkStealingPool pool{threads};
+		TiledRasterRenderer tiled{pool, width, height};
+		// 先画一帧, 让队列和各个 tile 的分组达到稳定容量
+		submit(tiled);
+		tiled.flush();
+		start = clock::now();
+		submit(tiled);
+		tiled.flush();
+		const auto tiled_time = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+		std::cout << "tiled, " << threads << " threads: " << tiled_time.count() << " us/frame"
+			<< (tiled.buffer().pixels() == serial.buffer().pixels() ? "" : " (MISMATCH)") << std::endl;
+	}
+}
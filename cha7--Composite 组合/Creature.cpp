@@ -2,7 +2,14 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
 #include <numeric>
+#include <random>
+#include <vector>
+
+#include "CreatureTable.hpp"
 
 class Creature {
 private:
@@ -51,4 +58,54 @@ public:
 	[[nodiscard]] int max() const {
 		return *std::max_element(abilities.begin(), abilities.end());
 	}
-};
\ No newline at end of file
+};
+
+// 1M 个生物每 tick 的 sum / average / max 和按列统计: Creature 数组逐个计算, 对比 CreatureTable 的批量 SIMD 版本
+void benchmark_creature_table() {
+	using clock = std::chrono::steady_clock;
+
+	constexpr std::size_t count = 1'000'000;
+	constexpr int ticks = 10;
+	std::mt19937 rng{3};
+	std::uniform_int_distribution<int> value{0, 100};
+
+	std::vector<Creature> creatures(count);
+	CreatureTable table;
+	table.reserve(count);
+	for (auto& creature : creatures) {
+		creature.set_strength(value(rng));
+		creature.set_agility(value(rng));
+		creature.set_intelligence(value(rng));
+		table.add(creature.get_strength(), creature.get_agility(), creature.get_intelligence());
+	}
+
+	std::vector<int> sums(count), maxes(count);
+	std::vector<double> averages(count);
+	long long strength_total = 0;
+	auto start = clock::now();
+	for (int tick = 0; tick < ticks; ++tick) {
+		strength_total = 0;
+		for (std::size_t i = 0; i < count; ++i) {
+			sums[i] = creatures[i].sum();
+			averages[i] = creatures[i].average();
+			maxes[i] = creatures[i].max();
+			strength_total += creatures[i].get_strength();
+		}
+	}
+	const auto aos = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+	std::vector<int> table_sums(count), table_maxes(count);
+	std::vector<double> table_averages(count);
+	std::int64_t table_strength_total = 0;
+	start = clock::now();
+	for (int tick = 0; tick < ticks; ++tick) {
+		table.aggregate(table_sums.data(), table_averages.data(), table_maxes.data());
+		table_strength_total = table.column_sum(CreatureTable::Abilities::strength_);
+	}
+	const auto soa = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+	const bool same = sums == table_sums && averages == table_averages && maxes == table_maxes &&
+		strength_total == table_strength_total && table[count / 2].max() == creatures[count / 2].max();
+	std::cout << "array of Creature: " << aos.count() / ticks << " us/tick, CreatureTable: " << soa.count() / ticks
+		<< " us/tick" << (same ? "" : " (MISMATCH)") << std::endl;
+}
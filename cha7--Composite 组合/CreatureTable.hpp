@@ -0,0 +1,244 @@
+#ifndef CREATURETABLE_HPP
+#define CREATURETABLE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// 结构体数组 (SoA) 形式的生物表: 每种属性一列, 各自连续存放.
+//
+// 逐生物的 sum / average / max 一次处理 4 个生物, 每列各读一个 128 位向量即可;
+// 按列的统计只扫描一列, 不会把其余属性也读进缓存
+class CreatureTable {
+public:
+	enum class Abilities {
+		strength_,
+		agility_,
+		intelligence_,
+		count,
+	};
+
+	static constexpr std::size_t ability_count = static_cast<std::size_t>(Abilities::count);
+
+private:
+	std::vector<int> columns_[ability_count];
+
+	[[nodiscard]] const int* column_data(const Abilities ability) const {
+		return columns_[static_cast<std::size_t>(ability)].data();
+	}
+
+public:
+	// 单个生物的代理视图, 接口与 Creature 相同, 读写直接落到表里对应的列上
+	template <typename Table>
+	class basic_creature_ref {
+	private:
+		Table* table_;
+		std::size_t index_;
+
+		[[nodiscard]] int get(const Abilities ability) const {
+			return table_->columns_[static_cast<std::size_t>(ability)][index_];
+		}
+
+		void set(const Abilities ability, const int value) const {
+			table_->columns_[static_cast<std::size_t>(ability)][index_] = value;
+		}
+
+	public:
+		basic_creature_ref(Table* table, const std::size_t index) : table_{table}, index_{index} {}
+
+		[[nodiscard]] std::size_t index() const { return index_; }
+
+		[[nodiscard]] int get_strength() const { return get(Abilities::strength_); }
+		[[nodiscard]] int get_agility() const { return get(Abilities::agility_); }
+		[[nodiscard]] int get_intelligence() const { return get(Abilities::intelligence_); }
+
+		void set_strength(const int strength) const { set(Abilities::strength_, strength); }
+		void set_agility(const int agility) const { set(Abilities::agility_, agility); }
+		void set_intelligence(const int intelligence) const { set(Abilities::intelligence_, intelligence); }
+
+		[[nodiscard]] int sum() const {
+			return get_strength() + get_agility() + get_intelligence();
+		}
+		[[nodiscard]] double average() const {
+			return sum() / static_cast<double>(ability_count);
+		}
+		[[nodiscard]] int max() const {
+			return std::max({get_strength(), get_agility(), get_intelligence()});
+		}
+	};
+
+	using creature_ref = basic_creature_ref<CreatureTable>;
+	using const_creature_ref = basic_creature_ref<const CreatureTable>;
+
+	// 对 const 表禁止写入
+	template <typename Table>
+	friend class basic_creature_ref;
+
+	[[nodiscard]] std::size_t size() const { return columns_[0].size(); }
+
+	void reserve(const std::size_t count) {
+		for (auto& column : columns_)
+			column.reserve(count);
+	}
+
+	std::size_t add(const int strength, const int agility, const int intelligence) {
+		columns_[static_cast<std::size_t>(Abilities::strength_)].push_back(strength);
+		columns_[static_cast<std::size_t>(Abilities::agility_)].push_back(agility);
+		columns_[static_cast<std::size_t>(Abilities::intelligence_)].push_back(intelligence);
+		return size() - 1;
+	}
+
+	[[nodiscard]] creature_ref operator[](const std::size_t index) { return creature_ref{this, index}; }
+	[[nodiscard]] const_creature_ref operator[](const std::size_t index) const { return const_creature_ref{this, index}; }
+
+	[[nodiscard]] const int* column(const Abilities ability) const { return column_data(ability); }
+
+	// 每个生物的属性和, out 至少 size() 个位置
+	void sums(int* out) const {
+		const int* s = column_data(Abilities::strength_);
+		const int* a = column_data(Abilities::agility_);
+		const int* n = column_data(Abilities::intelligence_);
+		const std::size_t count = size();
+		std::size_t i = 0;
+#ifdef __SSE2__
+		for (; i + 4 <= count; i += 4) {
+			const __m128i sum = _mm_add_epi32(
+				_mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i)),
+				              _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i))),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(n + i)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), sum);
+		}
+#endif
+		for (; i < count; ++i)
+			out[i] = s[i] + a[i] + n[i];
+	}
+
+	// 每个生物的属性平均值
+	void averages(double* out) const {
+		const int* s = column_data(Abilities::strength_);
+		const int* a = column_data(Abilities::agility_);
+		const int* n = column_data(Abilities::intelligence_);
+		const std::size_t count = size();
+		std::size_t i = 0;
+#ifdef __SSE2__
+		const __m128d divisor = _mm_set1_pd(static_cast<double>(ability_count));
+		for (; i + 4 <= count; i += 4) {
+			const __m128i sum = _mm_add_epi32(
+				_mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i)),
+				              _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i))),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(n + i)));
+			// 4 个 int 分两次转成 double
+			_mm_storeu_pd(out + i, _mm_div_pd(_mm_cvtepi32_pd(sum), divisor));
+			_mm_storeu_pd(out + i + 2, _mm_div_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(sum, sum)), divisor));
+		}
+#endif
+		for (; i < count; ++i)
+			out[i] = (s[i] + a[i] + n[i]) / static_cast<double>(ability_count);
+	}
+
+	// 每个生物的最大属性
+	void maxes(int* out) const {
+		const int* s = column_data(Abilities::strength_);
+		const int* a = column_data(Abilities::agility_);
+		const int* n = column_data(Abilities::intelligence_);
+		const std::size_t count = size();
+		std::size_t i = 0;
+#ifdef __SSE2__
+		// SSE2 没有 32 位整数的 max, 用比较结果做掩码选择
+		auto max_epi32 = [](const __m128i x, const __m128i y) {
+			const __m128i greater = _mm_cmpgt_epi32(x, y);
+			return _mm_or_si128(_mm_and_si128(greater, x), _mm_andnot_si128(greater, y));
+		};
+		for (; i + 4 <= count; i += 4) {
+			const __m128i m = max_epi32(
+				max_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i)),
+				          _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i))),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(n + i)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), m);
+		}
+#endif
+		for (; i < count; ++i)
+			out[i] = std::max({s[i], a[i], n[i]});
+	}
+
+	// 一趟同时算出三者, 每个生物的三列只读一次
+	void aggregate(int* sums_out, double* averages_out, int* maxes_out) const {
+		const int* s = column_data(Abilities::strength_);
+		const int* a = column_data(Abilities::agility_);
+		const int* n = column_data(Abilities::intelligence_);
+		const std::size_t count = size();
+		std::size_t i = 0;
+#ifdef __SSE2__
+		const __m128d divisor = _mm_set1_pd(static_cast<double>(ability_count));
+		auto max_epi32 = [](const __m128i x, const __m128i y) {
+			const __m128i greater = _mm_cmpgt_epi32(x, y);
+			return _mm_or_si128(_mm_and_si128(greater, x), _mm_andnot_si128(greater, y));
+		};
+		for (; i + 4 <= count; i += 4) {
+			const __m128i vs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+			const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+			const __m128i vn = _mm_loadu_si128(reinterpret_cast<const __m128i*>(n + i));
+			const __m128i sum = _mm_add_epi32(_mm_add_epi32(vs, va), vn);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(sums_out + i), sum);
+			_mm_storeu_pd(averages_out + i, _mm_div_pd(_mm_cvtepi32_pd(sum), divisor));
+			_mm_storeu_pd(averages_out + i + 2, _mm_div_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(sum, sum)), divisor));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(maxes_out + i), max_epi32(max_epi32(vs, va), vn));
+		}
+#endif
+		for (; i < count; ++i) {
+			sums_out[i] = s[i] + a[i] + n[i];
+			averages_out[i] = sums_out[i] / static_cast<double>(ability_count);
+			maxes_out[i] = std::max({s[i], a[i], n[i]});
+		}
+	}
+
+	// 按列统计: 整列求和用 64 位累加, 不会因生物数量大而溢出
+	[[nodiscard]] std::int64_t column_sum(const Abilities ability) const {
+		const int* c = column_data(ability);
+		const std::size_t count = size();
+		std::int64_t partial[4] = {0, 0, 0, 0};
+		std::size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+			for (std::size_t k = 0; k < 4; ++k)
+				partial[k] += c[i + k];
+		for (; i < count; ++i)
+			partial[0] += c[i];
+		return partial[0] + partial[1] + partial[2] + partial[3];
+	}
+
+	[[nodiscard]] double column_average(const Abilities ability) const {
+		return size() == 0 ? 0.0 : static_cast<double>(column_sum(ability)) / static_cast<double>(size());
+	}
+
+	// 空表返回 int 的最小值
+	[[nodiscard]] int column_max(const Abilities ability) const {
+		const int* c = column_data(ability);
+		const std::size_t count = size();
+		int result = std::numeric_limits<int>::min();
+		std::size_t i = 0;
+#ifdef __SSE2__
+		if (count >= 4) {
+			__m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c));
+			for (i = 4; i + 4 <= count; i += 4) {
+				const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c + i));
+				const __m128i greater = _mm_cmpgt_epi32(x, m);
+				m = _mm_or_si128(_mm_and_si128(greater, x), _mm_andnot_si128(greater, m));
+			}
+			alignas(16) int lanes[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(lanes), m);
+			result = std::max({lanes[0], lanes[1], lanes[2], lanes[3]});
+		}
+#endif
+		for (; i < count; ++i)
+			result = std::max(result, c[i]);
+		return result;
+	}
+};
+
+#endif //CREATURETABLE_HPP
@@ -0,0 +1,119 @@
+#ifndef DENSEKERNELS_HPP
+#define DENSEKERNELS_HPP
+
+#include <algorithm>
+#include <cstddef>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// 全连接层用到的矩阵核.
+//
+// 权重矩阵 W 按行存放, 第 o 行是第 o 个输出神经元的全部输入权重; 一批输入 X 也按行存放, 每行一个样本.
+// 于是每个 (样本, 输出) 都是两段连续内存的点积, 可以直接用 SIMD 累加
+
+namespace detail {
+
+#ifdef __SSE2__
+inline float horizontal_sum(const __m128 v) {
+	const __m128 shuffled = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+	const __m128 sums = _mm_add_ps(v, shuffled);
+	return _mm_cvtss_f32(_mm_add_ss(sums, _mm_movehl_ps(shuffled, sums)));
+}
+#endif
+
+// 4 个输出 x 2 个样本的寄存器分块: 每读一次 X 的 4 个元素供 4 行 W 复用, 每读一次 W 供 2 个样本复用
+inline void dense_tile_4x2(const float* const w[4], const float* x0, const float* x1, const std::size_t n,
+                           float out0[4], float out1[4]) {
+	std::size_t k = 0;
+#ifdef __SSE2__
+	// 8 个累加器手工展开, 保证都留在寄存器里
+	__m128 a0 = _mm_setzero_ps(), a1 = _mm_setzero_ps(), a2 = _mm_setzero_ps(), a3 = _mm_setzero_ps();
+	__m128 b0 = _mm_setzero_ps(), b1 = _mm_setzero_ps(), b2 = _mm_setzero_ps(), b3 = _mm_setzero_ps();
+	for (; k + 4 <= n; k += 4) {
+		const __m128 xa = _mm_loadu_ps(x0 + k);
+		const __m128 xb = _mm_loadu_ps(x1 + k);
+		const __m128 w0 = _mm_loadu_ps(w[0] + k);
+		const __m128 w1 = _mm_loadu_ps(w[1] + k);
+		const __m128 w2 = _mm_loadu_ps(w[2] + k);
+		const __m128 w3 = _mm_loadu_ps(w[3] + k);
+		a0 = _mm_add_ps(a0, _mm_mul_ps(w0, xa));
+		b0 = _mm_add_ps(b0, _mm_mul_ps(w0, xb));
+		a1 = _mm_add_ps(a1, _mm_mul_ps(w1, xa));
+		b1 = _mm_add_ps(b1, _mm_mul_ps(w1, xb));
+		a2 = _mm_add_ps(a2, _mm_mul_ps(w2, xa));
+		b2 = _mm_add_ps(b2, _mm_mul_ps(w2, xb));
+		a3 = _mm_add_ps(a3, _mm_mul_ps(w3, xa));
+		b3 = _mm_add_ps(b3, _mm_mul_ps(w3, xb));
+	}
+	out0[0] = horizontal_sum(a0);
+	out0[1] = horizontal_sum(a1);
+	out0[2] = horizontal_sum(a2);
+	out0[3] = horizontal_sum(a3);
+	out1[0] = horizontal_sum(b0);
+	out1[1] = horizontal_sum(b1);
+	out1[2] = horizontal_sum(b2);
+	out1[3] = horizontal_sum(b3);
+#else
+	for (int r = 0; r < 4; ++r)
+		out0[r] = out1[r] = 0.0f;
+#endif
+	for (; k < n; ++k) {
+		for (int r = 0; r < 4; ++r) {
+			out0[r] += w[r][k] * x0[k];
+			out1[r] += w[r][k] * x1[k];
+		}
+	}
+}
+
+inline float dot(const float* a, const float* b, const std::size_t n) {
+	std::size_t k = 0;
+	float result = 0.0f;
+#ifdef __SSE2__
+	__m128 acc = _mm_setzero_ps();
+	for (; k + 4 <= n; k += 4)
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + k), _mm_loadu_ps(b + k)));
+	result = horizontal_sum(acc);
+#endif
+	for (; k < n; ++k)
+		result += a[k] * b[k];
+	return result;
+}
+
+} // namespace detail
+
+// z[b * z_stride + o] += W[o] . X[b], 其中 o 属于 [row_first, row_last), b 属于 [0, batch), 每行取前 cols 个元素.
+// 输入维度按 block_cols 分块, 一块 W 在处理完整批样本之前一直留在 L1 里; batch 为 1 时就是矩阵-向量乘
+inline void dense_accumulate(const float* w, const std::size_t w_stride,
+                             const std::size_t row_first, const std::size_t row_last, const std::size_t cols,
+                             const float* x, const std::size_t x_stride, const std::size_t batch,
+                             float* z, const std::size_t z_stride) {
+	constexpr std::size_t block_cols = 512;
+	for (std::size_t k0 = 0; k0 < cols; k0 += block_cols) {
+		const std::size_t n = std::min(block_cols, cols - k0);
+		std::size_t o = row_first;
+		for (; o + 4 <= row_last; o += 4) {
+			const float* rows[4] = {
+				w + o * w_stride + k0, w + (o + 1) * w_stride + k0,
+				w + (o + 2) * w_stride + k0, w + (o + 3) * w_stride + k0};
+			std::size_t b = 0;
+			for (; b + 2 <= batch; b += 2) {
+				float out0[4], out1[4];
+				detail::dense_tile_4x2(rows, x + b * x_stride + k0, x + (b + 1) * x_stride + k0, n, out0, out1);
+				for (int r = 0; r < 4; ++r) {
+					z[b * z_stride + o + r] += out0[r];
+					z[(b + 1) * z_stride + o + r] += out1[r];
+				}
+			}
+			for (; b < batch; ++b)
+				for (int r = 0; r < 4; ++r)
+					z[b * z_stride + o + r] += detail::dot(rows[r], x + b * x_stride + k0, n);
+		}
+		for (; o < row_last; ++o)
+			for (std::size_t b = 0; b < batch; ++b)
+				z[b * z_stride + o] += detail::dot(w + o * w_stride + k0, x + b * x_stride + k0, n);
+	}
+}
+
+#endif //DENSEKERNELS_HPP
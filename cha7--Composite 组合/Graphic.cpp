@@ -1,18 +1,78 @@
 #include "Graphic.h"
 
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "WorkStealingPool.hpp"
+
+// 轴对齐包围盒, 默认为空
+struct Bounds {
+	float x0{std::numeric_limits<float>::infinity()};
+	float y0{std::numeric_limits<float>::infinity()};
+	float x1{-std::numeric_limits<float>::infinity()};
+	float y1{-std::numeric_limits<float>::infinity()};
+
+	[[nodiscard]] bool empty() const { return x0 > x1 || y0 > y1; }
+
+	void expand(const Bounds& other) {
+		x0 = std::min(x0, other.x0);
+		y0 = std::min(y0, other.y0);
+		x1 = std::max(x1, other.x1);
+		y1 = std::max(y1, other.y1);
+	}
+
+	[[nodiscard]] bool intersects(const Bounds& other) const {
+		return x0 <= other.x1 && other.x0 <= x1 && y0 <= other.y1 && other.y0 <= y1;
+	}
+
+	[[nodiscard]] bool contains(const float x, const float y) const {
+		return x >= x0 && x <= x1 && y >= y0 && y <= y1;
+	}
+};
+
 class GraphicObject {
 public:
 	virtual ~GraphicObject() = default;
 	virtual void draw() = 0;
+	[[nodiscard]] virtual Bounds bounds() const = 0;
+
+	// 默认按包围盒判断, 形状可以给出精确的判断
+	[[nodiscard]] virtual bool contains(const float x, const float y) const {
+		return bounds().contains(x, y);
+	}
 };
 
 struct Circle final : GraphicObject {
+	float x_{0};
+	float y_{0};
+	float radius_{1};
+
+	Circle() = default;
+	Circle(const float x, const float y, const float radius) : x_{x}, y_{y}, radius_{radius} {}
+
 	void draw() override {
 		std::cout << "Circle" << std::endl;
 	}
+
+	[[nodiscard]] Bounds bounds() const override {
+		return Bounds{x_ - radius_, y_ - radius_, x_ + radius_, y_ + radius_};
+	}
+
+	[[nodiscard]] bool contains(const float x, const float y) const override {
+		return (x - x_) * (x - x_) + (y - y_) * (y - y_) <= radius_ * radius_;
+	}
 };
 
 struct Group final : GraphicObject {
@@ -28,8 +88,496 @@ public:
 			o->draw();
 		}
 	}
+
+	// 每次都遍历整个子树; 需要反复查询时用 BoundingVolumeHierarchy 缓存
+	[[nodiscard]] Bounds bounds() const override {
+		Bounds result;
+		for (auto* o : objects)
+			result.expand(o->bounds());
+		return result;
+	}
+
+	[[nodiscard]] bool contains(const float x, const float y) const override {
+		return std::any_of(objects.begin(), objects.end(), [&](const GraphicObject* o) { return o->contains(x, y); });
+	}
+};
+
+// 建在 Composite 层次上的包围盒层次 (BVH).
+//
+// 每个组各有一棵局部的二叉 BVH, 叶子是它的直接子对象, 子组以它自己那棵树的根包围盒参与构建;
+// 于是绘制和点选只会进入与视口/点相交的组和子树. 组的子对象(增删或移动)改变后调用 update(group),
+// 只重建这个组的局部树, 再沿父链重新计算祖先局部树的包围盒, 其余组不受影响.
+// 要求每个组在层次里只出现一次
+class BoundingVolumeHierarchy {
+private:
+	static constexpr std::size_t leaf_size = 4;
+	// 中位数对半分, 局部树的深度不超过 log2(子对象数) + 1, 32 位下标时至多 33 层, 遍历栈不会超过这个深度
+	static constexpr std::size_t max_depth = 64;
+
+	// count > 0 为叶子, 对应 items[first, first + count); 否则左右孩子是 nodes[first] 和 nodes[first + 1]
+	struct Node {
+		Bounds bounds;
+		std::uint32_t first;
+		std::uint32_t count;
+	};
+
+	struct GroupTree {
+		const Group* parent;
+		std::vector<Node> nodes;
+		std::vector<GraphicObject*> items;
+	};
+
+	Group* root_;
+	std::unordered_map<const Group*, GroupTree> trees_;
+
+	[[nodiscard]] Bounds bounds_of(GraphicObject* object) const {
+		if (auto* group = dynamic_cast<Group*>(object)) {
+			const GroupTree& tree = trees_.at(group);
+			return tree.nodes.empty() ? Bounds{} : tree.nodes.front().bounds;
+		}
+		return object->bounds();
+	}
+
+	// 按包围盒中心在较长的轴上取中位数对半分
+	static void split(GroupTree& tree, std::vector<Bounds>& item_bounds, const std::uint32_t node,
+	                  const std::uint32_t first, const std::uint32_t count) {
+		Bounds bounds;
+		for (std::uint32_t i = first; i < first + count; ++i)
+			bounds.expand(item_bounds[i]);
+		tree.nodes[node].bounds = bounds;
+		if (count <= leaf_size) {
+			tree.nodes[node].first = first;
+			tree.nodes[node].count = count;
+			return;
+		}
+
+		const bool x_axis = bounds.x1 - bounds.x0 >= bounds.y1 - bounds.y0;
+		std::vector<std::uint32_t> order(count);
+		for (std::uint32_t i = 0; i < count; ++i)
+			order[i] = first + i;
+		const std::uint32_t half = count / 2;
+		std::nth_element(order.begin(), order.begin() + half, order.end(), [&](const std::uint32_t a, const std::uint32_t b) {
+			const Bounds& ba = item_bounds[a];
+			const Bounds& bb = item_bounds[b];
+			return x_axis ? ba.x0 + ba.x1 < bb.x0 + bb.x1 : ba.y0 + ba.y1 < bb.y0 + bb.y1;
+		});
+		std::vector<GraphicObject*> items(count);
+		std::vector<Bounds> sorted_bounds(count);
+		for (std::uint32_t i = 0; i < count; ++i) {
+			items[i] = tree.items[order[i]];
+			sorted_bounds[i] = item_bounds[order[i]];
+		}
+		std::copy(items.begin(), items.end(), tree.items.begin() + first);
+		std::copy(sorted_bounds.begin(), sorted_bounds.end(), item_bounds.begin() + first);
+
+		const auto left = static_cast<std::uint32_t>(tree.nodes.size());
+		tree.nodes.emplace_back();
+		tree.nodes.emplace_back();
+		tree.nodes[node].first = left;
+		tree.nodes[node].count = 0;
+		split(tree, item_bounds, left, first, half);
+		split(tree, item_bounds, left + 1, first + half, count - half);
+	}
+
+	// 子组先建好, 再建这个组的局部树
+	void build(Group& group, const Group* parent) {
+		for (auto* child : group.objects)
+			if (auto* child_group = dynamic_cast<Group*>(child))
+				build(*child_group, &group);
+		rebuild_local(group, parent);
+	}
+
+	void rebuild_local(const Group& group, const Group* parent) {
+		GroupTree& tree = trees_[&group];
+		tree.parent = parent;
+		tree.items = group.objects;
+		tree.nodes.clear();
+		if (tree.items.empty())
+			return;
+		std::vector<Bounds> item_bounds(tree.items.size());
+		for (std::size_t i = 0; i < tree.items.size(); ++i)
+			item_bounds[i] = bounds_of(tree.items[i]);
+		tree.nodes.emplace_back();
+		split(tree, item_bounds, 0, 0, static_cast<std::uint32_t>(tree.items.size()));
+	}
+
+	// 结构不变, 只自底向上重新计算包围盒 (孩子总是排在父节点之后)
+	void refit(GroupTree& tree) {
+		for (std::size_t i = tree.nodes.size(); i-- > 0;) {
+			Node& node = tree.nodes[i];
+			Bounds bounds;
+			if (node.count > 0) {
+				for (std::uint32_t k = node.first; k < node.first + node.count; ++k)
+					bounds.expand(bounds_of(tree.items[k]));
+			} else {
+				bounds = tree.nodes[node.first].bounds;
+				bounds.expand(tree.nodes[node.first + 1].bounds);
+			}
+			node.bounds = bounds;
+		}
+	}
+
+	// 删除 group 及仍挂在它下面的各子组的局部树; 已经被 update 挪到别的父组下的子组保留
+	void erase(const Group& group) {
+		const auto found = trees_.find(&group);
+		if (found == trees_.end())
+			return;
+		for (auto* item : found->second.items)
+			if (auto* child = dynamic_cast<Group*>(item)) {
+				const auto child_tree = trees_.find(child);
+				if (child_tree != trees_.end() && child_tree->second.parent == &group)
+					erase(*child);
+			}
+		trees_.erase(found);
+	}
+
+	// 对与 region 相交的每个叶子对象调用 f(object); enter(group) 在进入组时调用
+	template <typename Enter, typename F>
+	void query(const Group& group, const Bounds& region, Enter& enter, F& f) const {
+		const GroupTree& tree = trees_.at(&group);
+		if (tree.nodes.empty() || !tree.nodes.front().bounds.intersects(region))
+			return;
+		enter(group);
+		std::uint32_t stack[max_depth];
+		std::size_t top = 0;
+		stack[top++] = 0;
+		while (top > 0) {
+			const Node& node = tree.nodes[stack[--top]];
+			if (!node.bounds.intersects(region))
+				continue;
+			if (node.count == 0) {
+				assert(top + 2 <= max_depth);
+				stack[top++] = node.first + 1;
+				stack[top++] = node.first;
+				continue;
+			}
+			for (std::uint32_t k = node.first; k < node.first + node.count; ++k) {
+				GraphicObject* object = tree.items[k];
+				if (auto* child = dynamic_cast<Group*>(object))
+					query(*child, region, enter, f);
+				else if (object->bounds().intersects(region))
+					f(*object);
+			}
+		}
+	}
+
+public:
+	explicit BoundingVolumeHierarchy(Group& root) : root_{&root} {
+		build(root, nullptr);
+	}
+
+	// group 的子对象已经改变: 重建它的局部树, 然后更新各祖先的包围盒.
+	// 新加入的子组一并建好, 从别处挪来的子组改记新的父组; 移出的子组连同其后代的局部树一起删除.
+	// 把子组从 A 挪到 B 时对 A 和 B 各调用一次 update, 先后不限
+	void update(Group& group) {
+		const auto found = trees_.find(&group);
+		if (found == trees_.end())
+			return;
+		const Group* parent = found->second.parent;
+		const std::vector<GraphicObject*> previous = found->second.items;
+
+		std::unordered_set<const GraphicObject*> current;
+		for (auto* child : group.objects) {
+			current.insert(child);
+			if (auto* child_group = dynamic_cast<Group*>(child)) {
+				const auto child_tree = trees_.find(child_group);
+				if (child_tree == trees_.end())
+					build(*child_group, &group);
+				else
+					child_tree->second.parent = &group;
+			}
+		}
+		for (auto* child : previous)
+			if (auto* child_group = dynamic_cast<Group*>(child); child_group && !current.count(child_group)) {
+				const auto child_tree = trees_.find(child_group);
+				if (child_tree != trees_.end() && child_tree->second.parent == &group)
+					erase(*child_group);
+			}
+
+		rebuild_local(group, parent);
+		for (const Group* p = parent; p; p = trees_.at(p).parent)
+			refit(trees_.at(p));
+	}
+
+	[[nodiscard]] Bounds bounds() const { return bounds_of(root_); }
+	// 当前保存局部树的组数
+	[[nodiscard]] std::size_t group_count() const { return trees_.size(); }
+
+	// 对与 region 相交的每个叶子对象调用 f(GraphicObject&)
+	template <typename F>
+	void query(const Bounds& region, F f) const {
+		auto enter = [](const Group&) {};
+		query(*root_, region, enter, f);
+	}
+
+	// 只绘制与视口相交的组和对象; 组内的绘制顺序是 BVH 的顺序
+	void draw(const Bounds& viewport) const {
+		auto enter = [](const Group& group) { std::cout << "Group" << group.name_ << " contains:" << std::endl; };
+		auto draw = [](GraphicObject& object) { object.draw(); };
+		query(*root_, viewport, enter, draw);
+	}
+
+	// 点选: 返回包含该点的某个对象, 没有时返回空
+	[[nodiscard]] GraphicObject* hit_test(const float x, const float y) const {
+		GraphicObject* hit = nullptr;
+		query(Bounds{x, y, x, y}, [&](GraphicObject& object) {
+			if (!hit && object.contains(x, y))
+				hit = &object;
+		});
+		return hit;
+	}
 };
 
+// 把 Group 层次编译成一段连续的绘制命令, 每帧只需顺序扫描, 没有逐节点的虚调用和指针跳转.
+//
+// 每个组在列表里占一段连续区间(组自己的开始命令加上全部后代), 组的子对象改变后调用 update,
+// 只重新生成这个组的那一段并拼接回去, 其余命令不动, 之后的区间整体平移.
+// 要求每个组在层次里只出现一次
+class DisplayList {
+public:
+	enum class Op : std::uint8_t {
+		begin_group, // object 是 Group
+		circle,
+		object,      // 其他类型的叶子, 仍然通过虚 draw() 绘制
+	};
+
+	struct Command {
+		Op op;
+		GraphicObject* object;
+	};
+
+private:
+	struct GroupSpan {
+		std::size_t first;
+		std::size_t count;
+		const Group* parent;
+	};
+
+	Group* root_;
+	std::vector<Command> commands_;
+	std::unordered_map<const Group*, GroupSpan> spans_;
+
+	// 把 object 及其后代追加到 out, base 是 out[0] 在整个列表里的位置; 其中各组的区间登记到 spans
+	static void emit(GraphicObject* object, const Group* parent, std::vector<Command>& out, const std::size_t base,
+	                 std::unordered_map<const Group*, GroupSpan>& spans) {
+		if (auto* group = dynamic_cast<Group*>(object)) {
+			const std::size_t first = base + out.size();
+			out.push_back(Command{Op::begin_group, group});
+			for (auto* child : group->objects)
+				emit(child, group, out, base, spans);
+			spans[group] = GroupSpan{first, base + out.size() - first, parent};
+		} else if (dynamic_cast<Circle*>(object)) {
+			out.push_back(Command{Op::circle, object});
+		} else {
+			out.push_back(Command{Op::object, object});
+		}
+	}
+
+public:
+	explicit DisplayList(Group& root) : root_{&root} {
+		rebuild();
+	}
+
+	[[nodiscard]] std::size_t size() const { return commands_.size(); }
+	[[nodiscard]] const std::vector<Command>& commands() const { return commands_; }
+
+	void rebuild() {
+		commands_.clear();
+		spans_.clear();
+		emit(root_, nullptr, commands_, 0, spans_);
+	}
+
+	// group 的子对象已经改变: 只重新生成它的区间
+	void update(const Group& group) {
+		const auto found = spans_.find(&group);
+		if (found == spans_.end())
+			return;
+		const GroupSpan old = found->second;
+		const std::size_t old_end = old.first + old.count;
+
+		// 旧区间里的后代组都作废, 由新生成的区间重新登记
+		for (std::size_t i = old.first + 1; i < old_end; ++i)
+			if (commands_[i].op == Op::begin_group)
+				spans_.erase(static_cast<const Group*>(commands_[i].object));
+
+		// 新区间先登记到单独的表里, 平移时 spans_ 里只剩按旧位置记录的区间
+		std::vector<Command> fresh;
+		std::unordered_map<const Group*, GroupSpan> fresh_spans;
+		emit(const_cast<Group*>(&group), old.parent, fresh, old.first, fresh_spans);
+		const auto delta = static_cast<std::ptrdiff_t>(fresh.size()) - static_cast<std::ptrdiff_t>(old.count);
+
+		commands_.erase(commands_.begin() + static_cast<std::ptrdiff_t>(old.first),
+		                commands_.begin() + static_cast<std::ptrdiff_t>(old_end));
+		commands_.insert(commands_.begin() + static_cast<std::ptrdiff_t>(old.first), fresh.begin(), fresh.end());
+
+		// 后面的区间整体平移, 祖先的区间随之伸缩
+		if (delta != 0) {
+			for (auto& [g, span] : spans_)
+				if (span.first >= old_end)
+					span.first += delta;
+			for (const Group* p = old.parent; p; p = spans_.at(p).parent)
+				spans_.at(p).count += delta;
+		}
+		for (const auto& [g, span] : fresh_spans)
+			spans_[g] = span;
+	}
+
+	// 输出与 root.draw() 相同
+	void draw() const {
+		for (const Command& command : commands_) {
+			switch (command.op) {
+			case Op::begin_group:
+				std::cout << "Group" << static_cast<const Group*>(command.object)->name_ << " contains:" << std::endl;
+				break;
+			case Op::circle:
+				std::cout << "Circle" << std::endl;
+				break;
+			case Op::object:
+				command.object->draw();
+				break;
+			}
+		}
+	}
+};
+
+// 并行访问 GraphicObject 层次里的所有叶子 (非 Group 的对象).
+//
+// 每个任务用显式栈做深度优先遍历, 栈里是 (组, 还没访问的子对象区间).
+// 任务每访问 grain 个叶子检查一次: 把栈底、也就是按深度优先顺序最靠后的那部分工作拆出去作为新任务
+// (栈里只剩一段区间时把它对半分), 交给 work stealing 线程池, 空闲线程会把它偷走.
+// 不需要预先知道子树大小, 一个任务至少处理 grain 个叶子才派生新任务, 所以任务数约为 叶子数 / grain.
+// 拆出去的总是当前任务剩余工作里最靠后的一段, 因此每个任务的输出在顺序上排在它派生的任务之前,
+// 有序版本据此把各任务的结果按深度优先顺序拼接起来
+namespace detail {
+
+struct VisitRange {
+	Group* group;
+	std::size_t first;
+	std::size_t last;
+};
+
+// 有序版本里每个任务的结果: 自己的输出, 然后按派生的逆序接上各子任务的结果
+template <typename T>
+struct VisitResult {
+	std::vector<T> items;
+	std::vector<std::unique_ptr<VisitResult>> spawned;
+};
+
+template <typename Leaf, typename Spawn>
+void visit_task(const VisitRange start, const std::size_t grain, Leaf& leaf, Spawn& spawn) {
+	std::deque<VisitRange> stack{start};
+	std::size_t work = 0;
+	while (!stack.empty()) {
+		if (work >= grain) {
+			work = 0;
+			VisitRange& bottom = stack.front();
+			if (stack.size() > 1) {
+				spawn(bottom);
+				stack.pop_front();
+			} else if (bottom.last - bottom.first >= 2) {
+				const std::size_t middle = bottom.first + (bottom.last - bottom.first) / 2;
+				spawn(VisitRange{bottom.group, middle, bottom.last});
+				bottom.last = middle;
+			}
+		}
+
+		VisitRange& top = stack.back();
+		if (top.first == top.last) {
+			stack.pop_back();
+			continue;
+		}
+		GraphicObject* object = top.group->objects[top.first++];
+		if (auto* group = dynamic_cast<Group*>(object)) {
+			stack.push_back(VisitRange{group, 0, group->objects.size()});
+		} else {
+			leaf(*object);
+			++work;
+		}
+	}
+}
+
+template <typename F>
+void spawn_unordered(WorkStealingPool::TaskGroup& tasks, const VisitRange range, const std::size_t grain, F& f) {
+	auto spawn = [&tasks, grain, &f](const VisitRange next) {
+		tasks.run([&tasks, next, grain, &f] { spawn_unordered(tasks, next, grain, f); });
+	};
+	visit_task(range, grain, f, spawn);
+}
+
+template <typename T, typename F>
+void spawn_ordered(WorkStealingPool::TaskGroup& tasks, const VisitRange range, const std::size_t grain, F& f,
+                   VisitResult<T>* result) {
+	auto leaf = [&f, result](GraphicObject& object) { result->items.push_back(f(object)); };
+	auto spawn = [&tasks, grain, &f, result](const VisitRange next) {
+		result->spawned.push_back(std::make_unique<VisitResult<T>>());
+		VisitResult<T>* child = result->spawned.back().get();
+		tasks.run([&tasks, next, grain, &f, child] { spawn_ordered<T>(tasks, next, grain, f, child); });
+	};
+	visit_task(range, grain, leaf, spawn);
+}
+
+} // namespace detail
+
+// 顺序版本, 作为参照
+template <typename F>
+void visit(GraphicObject& root, F f) {
+	if (auto* group = dynamic_cast<Group*>(&root)) {
+		for (auto* child : group->objects)
+			visit(*child, f);
+	} else {
+		f(root);
+	}
+}
+
+// 无序版本: f(GraphicObject&) 会在多个线程上同时被调用, 调用顺序不确定; 全部访问完才返回
+template <typename F>
+void parallel_visit(GraphicObject& root, WorkStealingPool& pool, F f, const std::size_t grain = 4096) {
+	auto* group = dynamic_cast<Group*>(&root);
+	if (!group) {
+		f(root);
+		return;
+	}
+	WorkStealingPool::TaskGroup tasks{pool};
+	detail::spawn_unordered(tasks, detail::VisitRange{group, 0, group->objects.size()}, std::max<std::size_t>(1, grain), f);
+	tasks.wait();
+}
+
+// 有序版本: 返回每个叶子的 f(leaf), 顺序与顺序遍历相同
+template <typename F>
+auto parallel_visit_ordered(GraphicObject& root, WorkStealingPool& pool, F f, const std::size_t grain = 4096) {
+	using T = decltype(f(root));
+	auto* group = dynamic_cast<Group*>(&root);
+	if (!group)
+		return std::vector<T>{f(root)};
+
+	detail::VisitResult<T> result;
+	{
+		WorkStealingPool::TaskGroup tasks{pool};
+		detail::spawn_ordered<T>(tasks, detail::VisitRange{group, 0, group->objects.size()}, std::max<std::size_t>(1, grain), f, &result);
+		tasks.wait();
+	}
+
+	// 展开成深度优先顺序的任务列表, 算出每段在结果里的位置, 再并行拷贝
+	std::vector<detail::VisitResult<T>*> order;
+	std::vector<detail::VisitResult<T>*> pending{&result};
+	while (!pending.empty()) {
+		detail::VisitResult<T>* node = pending.back();
+		pending.pop_back();
+		order.push_back(node);
+		for (auto& child : node->spawned)
+			pending.push_back(child.get());
+	}
+	std::vector<std::size_t> offsets(order.size() + 1, 0);
+	for (std::size_t i = 0; i < order.size(); ++i)
+		offsets[i + 1] = offsets[i] + order[i]->items.size();
+
+	std::vector<T> values(offsets.back());
+	pool.parallel_for(order.size(), [&](const std::size_t i) {
+		std::move(order[i]->items.begin(), order[i]->items.end(), values.begin() + static_cast<std::ptrdiff_t>(offsets[i]));
+	});
+	return values;
+}
+
 void test() {
 	Group root("root");
 	Circle c1, c2;
@@ -41,4 +589,241 @@ void test() {
 	root.objects.push_back(&subgroup);
 
 	root.draw();
-}
\ No newline at end of file
+}
+
+// 深层次(一条很长的组链)和宽层次(一层很多组)各 10 帧, 递归 draw() 对比 DisplayList 的顺序扫描.
+// 输出被屏蔽, 只比较遍历本身; 最后比较修改一个组后局部 update 与整体 rebuild 的开销
+void benchmark_display_list() {
+	using clock = std::chrono::steady_clock;
+
+	auto time_frames = [](auto&& draw_frame) {
+		constexpr int frames = 10;
+		std::cout.setstate(std::ios::badbit);
+		const auto start = clock::now();
+		for (int frame = 0; frame < frames; ++frame)
+			draw_frame();
+		const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+		std::cout.clear();
+		return elapsed.count() / frames;
+	};
+
+	std::vector<std::unique_ptr<Circle>> circles;
+	std::vector<std::unique_ptr<Group>> groups;
+	auto make_group = [&](Group* parent, const int circle_count) {
+		groups.push_back(std::make_unique<Group>(std::to_string(groups.size())));
+		Group* group = groups.back().get();
+		for (int i = 0; i < circle_count; ++i) {
+			circles.push_back(std::make_unique<Circle>());
+			group->objects.push_back(circles.back().get());
+		}
+		if (parent)
+			parent->objects.push_back(group);
+		return group;
+	};
+
+	// 深: 5000 层, 每层 100 个圆
+	Group* deep = make_group(nullptr, 100);
+	for (Group* g = deep; groups.size() < 5000;)
+		g = make_group(g, 100);
+	DisplayList deep_list{*deep};
+	std::cout << "deep:  recursive " << time_frames([&] { deep->draw(); }) << " us/frame, display list "
+		<< time_frames([&] { deep_list.draw(); }) << " us/frame (" << deep_list.size() << " commands)" << std::endl;
+
+	// 宽: 一层 5000 个组, 每组 100 个圆
+	Group* wide = make_group(nullptr, 0);
+	std::vector<Group*> wide_children;
+	for (int i = 0; i < 5000; ++i)
+		wide_children.push_back(make_group(wide, 100));
+	DisplayList wide_list{*wide};
+	std::cout << "wide:  recursive " << time_frames([&] { wide->draw(); }) << " us/frame, display list "
+		<< time_frames([&] { wide_list.draw(); }) << " us/frame (" << wide_list.size() << " commands)" << std::endl;
+
+	// 增量更新一个组, 与完整重建比较耗时和结果
+	auto check_update = [](const char* label, DisplayList& list, Group& root, const Group& changed) {
+		auto start = clock::now();
+		list.update(changed);
+		const auto update = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+		start = clock::now();
+		DisplayList rebuilt{root};
+		const auto rebuild = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+		bool same = rebuilt.size() == list.size();
+		for (std::size_t i = 0; same && i < rebuilt.size(); ++i)
+			same = rebuilt.commands()[i].op == list.commands()[i].op &&
+				rebuilt.commands()[i].object == list.commands()[i].object;
+		std::cout << label << " update: " << update.count() << " us, rebuild: " << rebuild.count() << " us"
+			<< (same ? "" : " (MISMATCH)") << std::endl;
+	};
+
+	// 缩小和扩大宽层次里的一个组
+	Group* changed = wide_children[wide_children.size() / 2];
+	changed->objects.pop_back();
+	check_update("shrink:", wide_list, *wide, *changed);
+	for (int i = 0; i < 3; ++i) {
+		circles.push_back(std::make_unique<Circle>());
+		changed->objects.push_back(circles.back().get());
+	}
+	check_update("grow:  ", wide_list, *wide, *changed);
+
+	// 深层次里的组在子组前面插入圆, 子组整体后移; 再更新这个子组, 它的区间必须已经落在新位置上
+	Group* outer = groups[1].get();
+	Group* inner = groups[2].get();
+	for (int i = 0; i < 3; ++i) {
+		circles.push_back(std::make_unique<Circle>());
+		outer->objects.insert(outer->objects.begin(), circles.back().get());
+	}
+	check_update("nested grow:", deep_list, *deep, *outer);
+	circles.push_back(std::make_unique<Circle>());
+	inner->objects.push_back(circles.back().get());
+	check_update("nested child:", deep_list, *deep, *inner);
+}
+
+
+// 10M 个叶子 (100 x 100 组, 每组 1000 个圆): 顺序遍历对比无序和有序的并行遍历, 并检查结果一致
+void benchmark_parallel_visit() {
+	using clock = std::chrono::steady_clock;
+
+	std::vector<Circle> circles(10'000'000);
+	std::vector<std::unique_ptr<Group>> groups;
+	Group root{"root"};
+	std::size_t next = 0;
+	for (int i = 0; i < 100; ++i) {
+		groups.push_back(std::make_unique<Group>("g" + std::to_string(i)));
+		Group* middle = groups.back().get();
+		root.objects.push_back(middle);
+		for (int j = 0; j < 100; ++j) {
+			groups.push_back(std::make_unique<Group>("g" + std::to_string(i) + "." + std::to_string(j)));
+			Group* bottom = groups.back().get();
+			middle->objects.push_back(bottom);
+			for (int k = 0; k < 1000; ++k)
+				bottom->objects.push_back(&circles[next++]);
+		}
+	}
+
+	// 每个叶子的"工作": 对地址做几轮混合, 结果写到该圆自己的位置上
+	auto work = [&circles](GraphicObject& leaf) {
+		std::uint64_t h = reinterpret_cast<std::uintptr_t>(&leaf);
+		for (int round = 0; round < 8; ++round) {
+			h ^= h >> 33;
+			h *= 0xff51afd7ed558ccdull;
+		}
+		return h;
+	};
+
+	std::vector<std::uint64_t> expected(circles.size());
+	auto start = clock::now();
+	visit(root, [&](GraphicObject& leaf) {
+		expected[static_cast<Circle*>(&leaf) - circles.data()] = work(leaf);
+	});
+	const auto sequential = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start);
+
+	WorkStealingPool pool;
+	std::vector<std::uint64_t> unordered(circles.size());
+	start = clock::now();
+	parallel_visit(root, pool, [&](GraphicObject& leaf) {
+		unordered[static_cast<Circle*>(&leaf) - circles.data()] = work(leaf);
+	});
+	const auto parallel = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start);
+
+	start = clock::now();
+	const std::vector<std::uint64_t> ordered = parallel_visit_ordered(root, pool, work);
+	const auto parallel_ordered = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start);
+
+	std::cout << pool.size() << " threads, sequential: " << sequential.count() << " ms, unordered: "
+		<< parallel.count() << " ms, ordered: " << parallel_ordered.count() << " ms"
+		<< (unordered == expected && ordered == expected ? "" : " (MISMATCH)") << std::endl;
+}
+
+
+// 1M 个圆分成 32 x 32 个空间上聚集的组, 分布在 10000 x 10000 的场景里:
+// 不同大小的视口下, 逐个检查全部对象对比 BVH 剔除的每帧开销; 随机点选; 以及移动一个圆后的增量更新
+void benchmark_bounding_volume_hierarchy() {
+	using clock = std::chrono::steady_clock;
+
+	constexpr int cells = 32;
+	constexpr float world = 10000.0f;
+	constexpr float cell = world / cells;
+	std::mt19937 rng{9};
+	std::uniform_real_distribution<float> offset{0.0f, cell};
+	std::uniform_real_distribution<float> radius{1.0f, 5.0f};
+
+	std::vector<Circle> circles;
+	circles.reserve(1'000'000);
+	std::vector<std::unique_ptr<Group>> groups;
+	Group root{"root"};
+	for (int gy = 0; gy < cells; ++gy) {
+		for (int gx = 0; gx < cells; ++gx) {
+			groups.push_back(std::make_unique<Group>(std::to_string(gx) + "," + std::to_string(gy)));
+			root.objects.push_back(groups.back().get());
+			for (int i = 0; i < 1'000'000 / (cells * cells); ++i) {
+				circles.emplace_back(gx * cell + offset(rng), gy * cell + offset(rng), radius(rng));
+				groups.back()->objects.push_back(&circles.back());
+			}
+		}
+	}
+
+	auto start = clock::now();
+	BoundingVolumeHierarchy bvh{root};
+	const auto build = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start);
+	std::cout << "build: " << build.count() << " ms" << std::endl;
+
+	for (const float size : {100.0f, 500.0f, 2000.0f, 5000.0f, 10000.0f}) {
+		const Bounds viewport{(world - size) / 2, (world - size) / 2, (world + size) / 2, (world + size) / 2};
+
+		start = clock::now();
+		std::size_t brute_visible = 0;
+		visit(root, [&](GraphicObject& object) {
+			if (object.bounds().intersects(viewport))
+				++brute_visible;
+		});
+		const auto brute = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+		start = clock::now();
+		std::size_t visible = 0;
+		bvh.query(viewport, [&](GraphicObject&) { ++visible; });
+		const auto culled = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+		std::cout << "viewport " << size << ": all objects " << brute.count() << " us, BVH " << culled.count()
+			<< " us (" << visible << " visible)" << (visible == brute_visible ? "" : " (MISMATCH)") << std::endl;
+	}
+
+	std::uniform_real_distribution<float> point{0.0f, world};
+	std::vector<std::pair<float, float>> points(10'000);
+	for (auto& p : points)
+		p = {point(rng), point(rng)};
+	start = clock::now();
+	std::size_t hits = 0;
+	for (const auto& [x, y] : points)
+		hits += bvh.hit_test(x, y) != nullptr;
+	const auto hit_time = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+	std::cout << "hit tests: " << points.size() << " in " << hit_time.count() << " us (" << hits << " hits)" << std::endl;
+
+	// 把一个圆移到场景另一头, 只更新它所在的组
+	Group& changed = *groups[100];
+	auto& moved = static_cast<Circle&>(*changed.objects.front());
+	moved.x_ = world - 1;
+	moved.y_ = world - 1;
+	start = clock::now();
+	bvh.update(changed);
+	const auto update = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+	const bool found = bvh.hit_test(world - 1, world - 1) != nullptr;
+	std::cout << "update one group: " << update.count() << " us" << (found ? "" : " (MISMATCH)") << std::endl;
+
+	// 把一个组挪到另一个组下面, 再把后者整个移出场景: 局部树随之删除, 查询结果与逐个检查一致
+	Group* moved_group = groups[200].get();
+	Group* new_parent = groups[300].get();
+	root.objects.erase(std::find(root.objects.begin(), root.objects.end(), moved_group));
+	new_parent->objects.push_back(moved_group);
+	bvh.update(*new_parent);
+	bvh.update(root);
+	const std::size_t before_removal = bvh.group_count();
+	root.objects.erase(std::find(root.objects.begin(), root.objects.end(), new_parent));
+	bvh.update(root);
+
+	const Bounds everything{0, 0, world, world};
+	std::size_t expected = 0, actual = 0;
+	visit(root, [&](GraphicObject& object) { expected += object.bounds().intersects(everything); });
+	bvh.query(everything, [&](GraphicObject&) { ++actual; });
+	std::cout << "reparent and remove: " << before_removal << " -> " << bvh.group_count() << " groups"
+		<< (before_removal == bvh.group_count() + 2 && actual == expected ? "" : " (MISMATCH)") << std::endl;
+}
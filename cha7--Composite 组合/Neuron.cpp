@@ -1,13 +1,89 @@
 #include "Neuron.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "DenseKernels.hpp"
+#include "WorkStealingPool.hpp"
+
 struct Neuron;
 
+class NeuronGraph;
+
+namespace neuron_file {
+void save(const NeuronGraph& graph, const std::string& path);
+}
+
+// 线程安全的分块编号: 每个线程一次从全局计数器领取一整块编号, 块内分配不需要任何同步.
+// 编号全局唯一, 但不同线程创建的神经元编号不再连续
+class NeuronIdAllocator {
+public:
+    static constexpr unsigned int block_size = 1024;
+
+    static unsigned int next() {
+        thread_local unsigned int current = 0;
+        thread_local unsigned int end = 0;
+        if (current == end) {
+            current = counter().fetch_add(block_size, std::memory_order_relaxed);
+            end = current + block_size;
+        }
+        return current++;
+    }
+
+private:
+    static std::atomic<unsigned int>& counter() {
+        static std::atomic<unsigned int> counter{1};
+        return counter;
+    }
+};
+
+enum class Activation : std::uint8_t {
+    identity,
+    relu,
+    sigmoid,
+};
+
+inline float activate(const Activation activation, const float x) {
+    switch (activation) {
+    case Activation::relu:
+        return x > 0.0f ? x : 0.0f;
+    case Activation::sigmoid:
+        return 1.0f / (1.0f + std::exp(-x));
+    case Activation::identity:
+        break;
+    }
+    return x;
+}
+
 template <typename Self>
 struct SomeNeurons {
 public:
     template <typename T>
     void connect_to(T& other);
+
+    // 连接只记录在 graph 里, 不修改各个 Neuron 的 in_ / out_
+    template <typename T>
+    void connect_to(T& other, NeuronGraph& graph);
 };
 
 struct Neuron : SomeNeurons<Neuron> {  // 此时SomeNeurons已完整定义
@@ -15,10 +91,7 @@ struct Neuron : SomeNeurons<Neuron> {  // 此时SomeNeurons已完整定义
     std::vector<Neuron*> out_;
     unsigned int id_;
 
-    Neuron() {
-        static int id = 1;
-        id_ = id++;
-    }
+    Neuron() : id_{NeuronIdAllocator::next()} {}
 
     Neuron* begin() { return this; }
     Neuron* end() { return this + 1; }
@@ -37,6 +110,559 @@ struct NeuronLayer : std::vector<Neuron>, SomeNeurons<NeuronLayer> {
     auto end() { return std::vector<Neuron>::end(); }
 };
 
+// 压缩稀疏行 (CSR) 形式的连接图.
+//
+// 神经元按注册顺序编号, 同一层的神经元编号连续, 所以层与层的全连接只需记下两段编号区间;
+// build 时先数出每个神经元的出度和入度, 前缀和得到各行的起点, 再一趟把所有边填进去.
+// 每条边在出边表和入边表里各占一个 32 位编号, 一个神经元的全部出边 / 入边连续存放.
+// 每个神经元另有偏置和激活函数, 每条入边有一个权重, 与 fan_in 的顺序一一对应
+class NeuronGraph {
+public:
+    using index_type = std::uint32_t;
+
+    // 某个神经元的出边或入边, 即一段连续的编号
+    struct Edges {
+        const index_type* first;
+        const index_type* last;
+
+        [[nodiscard]] const index_type* begin() const { return first; }
+        [[nodiscard]] const index_type* end() const { return last; }
+        [[nodiscard]] std::size_t size() const { return static_cast<std::size_t>(last - first); }
+    };
+
+    // 某个神经元的入边权重
+    struct Weights {
+        float* first;
+        float* last;
+
+        [[nodiscard]] float* begin() const { return first; }
+        [[nodiscard]] float* end() const { return last; }
+        [[nodiscard]] std::size_t size() const { return static_cast<std::size_t>(last - first); }
+        float& operator[](const std::size_t i) const { return first[i]; }
+    };
+
+    // 全连接的一块: [from_first, from_first + from_count) x [to_first, to_first + to_count)
+    struct Block {
+        index_type from_first;
+        index_type from_count;
+        index_type to_first;
+        index_type to_count;
+    };
+
+private:
+    std::vector<Neuron*> nodes_;
+    std::unordered_map<const Neuron*, index_type> index_;
+    std::vector<Block> blocks_;
+    bool built_{true};
+
+    std::vector<std::size_t> out_offsets_{0};
+    std::vector<index_type> out_targets_;
+    std::vector<std::size_t> in_offsets_{0};
+    std::vector<index_type> in_sources_;
+
+    std::vector<float> biases_;
+    std::vector<Activation> activations_;
+    std::vector<float> weights_; // 与 in_sources_ 平行
+
+    friend void neuron_file::save(const NeuronGraph& graph, const std::string& path);
+
+public:
+    // 一个已注册的神经元或一层对应的编号区间 (第一个编号, 个数).
+    // 这一层必须是一次 add 注册的, 编号连续; 否则区间会覆盖到别的神经元, 这里直接拒绝
+    template <typename T>
+    std::pair<index_type, index_type> range_of(T& neurons) const {
+        auto first = neurons.begin();
+        const auto last = neurons.end();
+        if (first == last)
+            return {0, 0};
+        const auto found = index_.find(&*first);
+        if (found == index_.end())
+            throw std::invalid_argument("NeuronGraph: neurons are not registered");
+        const index_type start = found->second;
+        const auto count = static_cast<std::size_t>(last - first);
+        if (start + count > nodes_.size())
+            throw std::out_of_range("NeuronGraph: neuron range out of bounds");
+        for (std::size_t k = 0; first != last; ++first, ++k)
+            if (nodes_[start + k] != &*first)
+                throw std::invalid_argument("NeuronGraph: neurons are not one contiguous registration");
+        return {start, static_cast<index_type>(count)};
+    }
+
+private:
+    // 按块的度数做前缀和, 然后逐块填充
+    static void fill(const std::size_t node_count, const std::vector<Block>& blocks, const bool outgoing,
+                     std::vector<std::size_t>& offsets, std::vector<index_type>& edges) {
+        offsets.assign(node_count + 1, 0);
+        for (const Block& b : blocks) {
+            const index_type first = outgoing ? b.from_first : b.to_first;
+            const index_type count = outgoing ? b.from_count : b.to_count;
+            const index_type degree = outgoing ? b.to_count : b.from_count;
+            for (index_type i = first; i < first + count; ++i)
+                offsets[i + 1] += degree;
+        }
+        for (std::size_t i = 0; i < node_count; ++i)
+            offsets[i + 1] += offsets[i];
+
+        edges.resize(offsets[node_count]);
+        std::vector<std::size_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (const Block& b : blocks) {
+            const index_type first = outgoing ? b.from_first : b.to_first;
+            const index_type count = outgoing ? b.from_count : b.to_count;
+            const index_type other_first = outgoing ? b.to_first : b.from_first;
+            const index_type other_count = outgoing ? b.to_count : b.from_count;
+            for (index_type i = first; i < first + count; ++i) {
+                index_type* out = edges.data() + cursor[i];
+                for (index_type k = 0; k < other_count; ++k)
+                    out[k] = other_first + k;
+                cursor[i] += other_count;
+            }
+        }
+    }
+
+public:
+    // 注册一个神经元或一整层, 返回第一个神经元的编号
+    template <typename T>
+    index_type add(T& neurons) {
+        const auto first = static_cast<index_type>(nodes_.size());
+        for (Neuron& neuron : neurons) {
+            index_.emplace(&neuron, static_cast<index_type>(nodes_.size()));
+            nodes_.push_back(&neuron);
+        }
+        biases_.resize(nodes_.size(), 0.0f);
+        activations_.resize(nodes_.size(), Activation::identity);
+        built_ = false;
+        return first;
+    }
+
+    // 全连接 from 中的每个神经元到 to 中的每个神经元, 两边都必须已经注册
+    template <typename From, typename To>
+    void connect(From& from, To& to) {
+        const auto [from_first, from_count] = range_of(from);
+        const auto [to_first, to_count] = range_of(to);
+        if (from_count == 0 || to_count == 0)
+            return;
+        blocks_.push_back(Block{from_first, from_count, to_first, to_count});
+        built_ = false;
+    }
+
+    // 生成 CSR 的出边表和入边表. 新的块总是排在各神经元已有入边之后, 所以之前设置的权重原样保留, 新边的权重为 0
+    void build() {
+        if (built_)
+            return;
+        const std::vector<std::size_t> old_offsets = std::move(in_offsets_);
+        const std::vector<float> old_weights = std::move(weights_);
+
+        fill(nodes_.size(), blocks_, true, out_offsets_, out_targets_);
+        fill(nodes_.size(), blocks_, false, in_offsets_, in_sources_);
+
+        weights_.assign(in_sources_.size(), 0.0f);
+        for (std::size_t i = 0; i + 1 < old_offsets.size(); ++i)
+            std::copy(old_weights.begin() + static_cast<std::ptrdiff_t>(old_offsets[i]),
+                      old_weights.begin() + static_cast<std::ptrdiff_t>(old_offsets[i + 1]),
+                      weights_.begin() + static_cast<std::ptrdiff_t>(in_offsets_[i]));
+        built_ = true;
+    }
+
+    [[nodiscard]] std::size_t node_count() const { return nodes_.size(); }
+    [[nodiscard]] std::size_t edge_count() const { return out_targets_.size(); }
+    [[nodiscard]] Neuron& neuron(const index_type i) const { return *nodes_[i]; }
+    [[nodiscard]] index_type index_of(const Neuron& neuron) const { return index_.at(&neuron); }
+
+    // 以下需要先 build
+    [[nodiscard]] Edges fan_out(const index_type i) const {
+        return Edges{out_targets_.data() + out_offsets_[i], out_targets_.data() + out_offsets_[i + 1]};
+    }
+    [[nodiscard]] Edges fan_in(const index_type i) const {
+        return Edges{in_sources_.data() + in_offsets_[i], in_sources_.data() + in_offsets_[i + 1]};
+    }
+    [[nodiscard]] Weights in_weights(const index_type i) {
+        return Weights{weights_.data() + in_offsets_[i], weights_.data() + in_offsets_[i + 1]};
+    }
+    [[nodiscard]] const float* in_weights_data(const index_type i) const { return weights_.data() + in_offsets_[i]; }
+
+    [[nodiscard]] const std::vector<Block>& blocks() const { return blocks_; }
+
+    [[nodiscard]] float bias(const index_type i) const { return biases_[i]; }
+    void set_bias(const index_type i, const float bias) { biases_[i] = bias; }
+
+    [[nodiscard]] Activation activation(const index_type i) const { return activations_[i]; }
+    template <typename T>
+    void set_activation(T& neurons, const Activation activation) {
+        const auto [first, count] = range_of(neurons);
+        std::fill(activations_.begin() + first, activations_.begin() + first + count, activation);
+    }
+};
+
+// 神经网络的二进制文件, 按主机字节序直接映射进内存:
+//
+// [Header][nodes: NodeRecord * node_count][blocks: Block * block_count]
+// [out_offsets: uint64 * (node_count + 1)][out_targets: uint32 * edge_count]
+// [in_offsets: uint64 * (node_count + 1)][in_sources: uint32 * edge_count][weights: float * edge_count]
+//
+// 即 NeuronGraph build 之后的 CSR 原样写出, 载入时各段直接指向映射的内存, 不需要逐边分配或解析
+namespace neuron_file {
+
+constexpr std::uint32_t magic = 0x474E524E; // "NRNG"
+constexpr std::uint32_t version = 1;
+
+struct Header {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t node_count;
+    std::uint32_t block_count;
+    std::uint64_t edge_count;
+    std::uint64_t nodes_offset;
+    std::uint64_t blocks_offset;
+    std::uint64_t out_offsets_offset;
+    std::uint64_t out_targets_offset;
+    std::uint64_t in_offsets_offset;
+    std::uint64_t in_sources_offset;
+    std::uint64_t weights_offset;
+    std::uint64_t file_size;
+};
+
+struct NodeRecord {
+    std::uint32_t id;
+    float bias;
+    Activation activation;
+    std::uint8_t reserved[3];
+};
+
+inline std::uint64_t align8(const std::uint64_t offset) {
+    return (offset + 7) & ~std::uint64_t{7};
+}
+
+// graph 必须已经 build
+inline void save(const NeuronGraph& graph, const std::string& path) {
+    const std::uint64_t n = graph.node_count();
+    const std::uint64_t e = graph.in_sources_.size();
+
+    Header header{};
+    header.magic = magic;
+    header.version = version;
+    header.node_count = static_cast<std::uint32_t>(n);
+    header.block_count = static_cast<std::uint32_t>(graph.blocks_.size());
+    header.edge_count = e;
+    header.nodes_offset = align8(sizeof(Header));
+    header.blocks_offset = align8(header.nodes_offset + n * sizeof(NodeRecord));
+    header.out_offsets_offset = align8(header.blocks_offset + graph.blocks_.size() * sizeof(NeuronGraph::Block));
+    header.out_targets_offset = align8(header.out_offsets_offset + (n + 1) * sizeof(std::uint64_t));
+    header.in_offsets_offset = align8(header.out_targets_offset + e * sizeof(NeuronGraph::index_type));
+    header.in_sources_offset = align8(header.in_offsets_offset + (n + 1) * sizeof(std::uint64_t));
+    header.weights_offset = align8(header.in_sources_offset + e * sizeof(NeuronGraph::index_type));
+    header.file_size = header.weights_offset + e * sizeof(float);
+
+    std::vector<NodeRecord> nodes(n);
+    for (std::size_t i = 0; i < n; ++i)
+        nodes[i] = NodeRecord{graph.nodes_[i]->id_, graph.biases_[i], graph.activations_[i], {0, 0, 0}};
+    const std::vector<std::uint64_t> out_offsets(graph.out_offsets_.begin(), graph.out_offsets_.end());
+    const std::vector<std::uint64_t> in_offsets(graph.in_offsets_.begin(), graph.in_offsets_.end());
+
+    std::vector<char> image(header.file_size, 0);
+    std::memcpy(image.data(), &header, sizeof(Header));
+    std::memcpy(image.data() + header.nodes_offset, nodes.data(), n * sizeof(NodeRecord));
+    std::memcpy(image.data() + header.blocks_offset, graph.blocks_.data(), graph.blocks_.size() * sizeof(NeuronGraph::Block));
+    std::memcpy(image.data() + header.out_offsets_offset, out_offsets.data(), (n + 1) * sizeof(std::uint64_t));
+    std::memcpy(image.data() + header.out_targets_offset, graph.out_targets_.data(), e * sizeof(NeuronGraph::index_type));
+    std::memcpy(image.data() + header.in_offsets_offset, in_offsets.data(), (n + 1) * sizeof(std::uint64_t));
+    std::memcpy(image.data() + header.in_sources_offset, graph.in_sources_.data(), e * sizeof(NeuronGraph::index_type));
+    std::memcpy(image.data() + header.weights_offset, graph.weights_.data(), e * sizeof(float));
+
+    // 先写临时文件再 rename, 已经映射着旧文件的进程不会读到写了一半的内容
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream ofs(temporary, std::ios::binary | std::ios::trunc);
+        if (!ofs.write(image.data(), static_cast<std::streamsize>(image.size())))
+            throw std::runtime_error("Cannot write " + temporary);
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+        throw std::runtime_error("Cannot replace " + path);
+}
+
+// 只读映射的网络: 接口与 NeuronGraph 的只读部分相同, 可以直接遍历或交给 ForwardPass
+class MappedNeuronGraph {
+public:
+    struct Blocks {
+        const NeuronGraph::Block* first;
+        const NeuronGraph::Block* last;
+
+        [[nodiscard]] const NeuronGraph::Block* begin() const { return first; }
+        [[nodiscard]] const NeuronGraph::Block* end() const { return last; }
+    };
+
+private:
+    const char* data_{nullptr};
+    std::size_t size_{0};
+    const Header* header_{nullptr};
+    const NodeRecord* nodes_{nullptr};
+    const NeuronGraph::Block* blocks_{nullptr};
+    const std::uint64_t* out_offsets_{nullptr};
+    const NeuronGraph::index_type* out_targets_{nullptr};
+    const std::uint64_t* in_offsets_{nullptr};
+    const NeuronGraph::index_type* in_sources_{nullptr};
+    const float* weights_{nullptr};
+
+    void unmap() {
+        if (data_)
+            ::munmap(const_cast<char*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    // 一组 CSR 偏移从 0 开始单调不减, 终点是边数, 且每条边指向的编号都在范围内
+    static bool valid_csr(const std::uint64_t* offsets, const NeuronGraph::index_type* edges,
+                          const std::uint64_t n, const std::uint64_t edge_count) {
+        if (offsets[0] != 0 || offsets[n] != edge_count)
+            return false;
+        for (std::uint64_t i = 0; i < n; ++i)
+            if (offsets[i] > offsets[i + 1])
+                return false;
+        return std::all_of(edges, edges + edge_count, [&](const NeuronGraph::index_type e) { return e < n; });
+    }
+
+    // 载入时一次性检查所有偏移和编号, 之后的访问 (包括 ForwardPass 按块重放入边) 都不会越界
+    [[nodiscard]] bool valid_contents() const {
+        const auto& h = *header_;
+        const std::uint64_t n = h.node_count;
+        if (!valid_csr(out_offsets_, out_targets_, n, h.edge_count) || !valid_csr(in_offsets_, in_sources_, n, h.edge_count))
+            return false;
+
+        // 各块必须落在神经元范围内, 且加起来恰好是每个神经元的出度和入度
+        std::vector<std::uint64_t> out_degree(n, 0), in_degree(n, 0);
+        for (std::uint32_t k = 0; k < h.block_count; ++k) {
+            const NeuronGraph::Block& b = blocks_[k];
+            if (std::uint64_t{b.from_first} + b.from_count > n || std::uint64_t{b.to_first} + b.to_count > n)
+                return false;
+            for (NeuronGraph::index_type i = b.from_first; i < b.from_first + b.from_count; ++i)
+                out_degree[i] += b.to_count;
+            for (NeuronGraph::index_type i = b.to_first; i < b.to_first + b.to_count; ++i)
+                in_degree[i] += b.from_count;
+        }
+        for (std::uint64_t i = 0; i < n; ++i)
+            if (out_degree[i] != out_offsets_[i + 1] - out_offsets_[i] || in_degree[i] != in_offsets_[i + 1] - in_offsets_[i])
+                return false;
+        return true;
+    }
+
+public:
+    explicit MappedNeuronGraph(const std::string& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Cannot open " + path);
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(Header)) {
+            ::close(fd);
+            throw std::runtime_error("Bad neuron file " + path);
+        }
+
+        size_ = static_cast<std::size_t>(st.st_size);
+        void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+            throw std::runtime_error("Cannot mmap " + path);
+        data_ = static_cast<const char*>(mapped);
+
+        header_ = reinterpret_cast<const Header*>(data_);
+        const auto& h = *header_;
+        const std::uint64_t n = h.node_count;
+        // 各偏移和边数都不超过文件大小, 下面的加法就不会溢出
+        const bool valid = h.magic == magic && h.version == version && h.file_size <= size_ &&
+            h.edge_count <= h.file_size && h.nodes_offset <= h.file_size && h.blocks_offset <= h.file_size &&
+            h.out_offsets_offset <= h.file_size && h.out_targets_offset <= h.file_size &&
+            h.in_offsets_offset <= h.file_size && h.in_sources_offset <= h.file_size && h.weights_offset <= h.file_size &&
+            h.nodes_offset % alignof(NodeRecord) == 0 && h.blocks_offset % alignof(NeuronGraph::Block) == 0 &&
+            h.out_offsets_offset % alignof(std::uint64_t) == 0 && h.in_offsets_offset % alignof(std::uint64_t) == 0 &&
+            h.out_targets_offset % alignof(NeuronGraph::index_type) == 0 &&
+            h.in_sources_offset % alignof(NeuronGraph::index_type) == 0 && h.weights_offset % alignof(float) == 0 &&
+            h.nodes_offset >= sizeof(Header) && h.nodes_offset + n * sizeof(NodeRecord) <= h.blocks_offset &&
+            h.blocks_offset + std::uint64_t{h.block_count} * sizeof(NeuronGraph::Block) <= h.out_offsets_offset &&
+            h.out_offsets_offset + (n + 1) * sizeof(std::uint64_t) <= h.out_targets_offset &&
+            h.out_targets_offset + h.edge_count * sizeof(NeuronGraph::index_type) <= h.in_offsets_offset &&
+            h.in_offsets_offset + (n + 1) * sizeof(std::uint64_t) <= h.in_sources_offset &&
+            h.in_sources_offset + h.edge_count * sizeof(NeuronGraph::index_type) <= h.weights_offset &&
+            h.weights_offset + h.edge_count * sizeof(float) <= h.file_size;
+        if (!valid) {
+            unmap();
+            throw std::runtime_error("Bad neuron file " + path);
+        }
+
+        nodes_ = reinterpret_cast<const NodeRecord*>(data_ + h.nodes_offset);
+        blocks_ = reinterpret_cast<const NeuronGraph::Block*>(data_ + h.blocks_offset);
+        out_offsets_ = reinterpret_cast<const std::uint64_t*>(data_ + h.out_offsets_offset);
+        out_targets_ = reinterpret_cast<const NeuronGraph::index_type*>(data_ + h.out_targets_offset);
+        in_offsets_ = reinterpret_cast<const std::uint64_t*>(data_ + h.in_offsets_offset);
+        in_sources_ = reinterpret_cast<const NeuronGraph::index_type*>(data_ + h.in_sources_offset);
+        weights_ = reinterpret_cast<const float*>(data_ + h.weights_offset);
+
+        if (!valid_contents()) {
+            unmap();
+            throw std::runtime_error("Bad neuron file " + path);
+        }
+    }
+
+    MappedNeuronGraph(const MappedNeuronGraph&) = delete;
+    MappedNeuronGraph& operator=(const MappedNeuronGraph&) = delete;
+
+    ~MappedNeuronGraph() { unmap(); }
+
+    [[nodiscard]] std::size_t node_count() const { return header_->node_count; }
+    [[nodiscard]] std::size_t edge_count() const { return header_->edge_count; }
+
+    [[nodiscard]] unsigned int id(const NeuronGraph::index_type i) const { return nodes_[i].id; }
+    [[nodiscard]] float bias(const NeuronGraph::index_type i) const { return nodes_[i].bias; }
+    [[nodiscard]] Activation activation(const NeuronGraph::index_type i) const { return nodes_[i].activation; }
+
+    [[nodiscard]] NeuronGraph::Edges fan_out(const NeuronGraph::index_type i) const {
+        return NeuronGraph::Edges{out_targets_ + out_offsets_[i], out_targets_ + out_offsets_[i + 1]};
+    }
+    [[nodiscard]] NeuronGraph::Edges fan_in(const NeuronGraph::index_type i) const {
+        return NeuronGraph::Edges{in_sources_ + in_offsets_[i], in_sources_ + in_offsets_[i + 1]};
+    }
+    [[nodiscard]] const float* in_weights_data(const NeuronGraph::index_type i) const { return weights_ + in_offsets_[i]; }
+
+    [[nodiscard]] Blocks blocks() const { return Blocks{blocks_, blocks_ + header_->block_count}; }
+};
+
+} // namespace neuron_file
+
+// 在 NeuronGraph 上做前向传播.
+//
+// 构造时把每个全连接块的权重从 CSR 里整理成一个稠密矩阵 (一行对应一个输出神经元), 之后图的修改不会影响它.
+// 块按加入图的顺序计算, 所以要求先连接前面的层; 一个块读取某段神经元之前, 先对它们应用激活函数.
+// 此后再有块写入这些神经元 (回边、连回前面层的跳连、环) 就无法计入, 构造时检查并抛出 std::invalid_argument.
+// 一次可以算一批输入, 矩阵足够大且给了线程池时, 按输出神经元分段并行
+class ForwardPass {
+private:
+    struct DenseBlock {
+        NeuronGraph::Block range;
+        std::vector<float> weights; // to_count x from_count
+    };
+
+    std::size_t node_count_;
+    std::vector<float> biases_;
+    std::vector<Activation> activations_;
+    std::vector<DenseBlock> blocks_;
+    std::pair<NeuronGraph::index_type, NeuronGraph::index_type> inputs_;
+    std::pair<NeuronGraph::index_type, NeuronGraph::index_type> outputs_;
+    WorkStealingPool* pool_;
+
+    // 每个样本一行, 一行覆盖全部神经元
+    std::vector<float> z_;
+    std::vector<float> a_;
+    std::vector<std::uint8_t> ready_;
+
+    void finalize(const NeuronGraph::index_type first, const NeuronGraph::index_type count, const std::size_t batch) {
+        for (NeuronGraph::index_type i = first; i < first + count; ++i) {
+            if (ready_[i])
+                continue;
+            for (std::size_t b = 0; b < batch; ++b)
+                a_[b * node_count_ + i] = activate(activations_[i], z_[b * node_count_ + i]);
+            ready_[i] = 1;
+        }
+    }
+
+    void accumulate(const DenseBlock& block, const std::size_t batch) {
+        const std::size_t rows = block.range.to_count;
+        const std::size_t cols = block.range.from_count;
+        const float* x = a_.data() + block.range.from_first;
+        float* z = z_.data() + block.range.to_first;
+
+        // 太小的矩阵分给线程池反而更慢
+        const std::size_t chunks = pool_ && rows * cols * batch >= (1u << 18) ? pool_->size() * 4 : 1;
+        const std::size_t chunk_rows = std::max<std::size_t>(4, (rows / chunks + 3) / 4 * 4);
+        const std::size_t chunk_count = (rows + chunk_rows - 1) / chunk_rows;
+        if (chunk_count <= 1) {
+            dense_accumulate(block.weights.data(), cols, 0, rows, cols, x, node_count_, batch, z, node_count_);
+            return;
+        }
+        pool_->parallel_for(chunk_count, [&](const std::size_t chunk) {
+            const std::size_t first = chunk * chunk_rows;
+            dense_accumulate(block.weights.data(), cols, first, std::min(rows, first + chunk_rows), cols,
+                             x, node_count_, batch, z, node_count_);
+        });
+    }
+
+    template <typename Graph>
+    void compile(const Graph& graph) {
+        for (NeuronGraph::index_type i = 0; i < node_count_; ++i) {
+            biases_.push_back(graph.bias(i));
+            activations_.push_back(graph.activation(i));
+        }
+
+        // 模拟 forward 的求值顺序: 输入一开始就算好, 每个块读取的神经元随后定值, 不能再被后面的块写入
+        std::vector<std::uint8_t> finalized(node_count_, 0);
+        std::fill(finalized.begin() + inputs_.first, finalized.begin() + inputs_.first + inputs_.second, 1);
+        for (const NeuronGraph::Block& range : graph.blocks()) {
+            std::fill(finalized.begin() + range.from_first, finalized.begin() + range.from_first + range.from_count, 1);
+            if (std::any_of(finalized.begin() + range.to_first, finalized.begin() + range.to_first + range.to_count,
+                            [](const std::uint8_t f) { return f != 0; }))
+                throw std::invalid_argument("ForwardPass: connections are not in feed-forward order");
+        }
+
+        // 按 build 时的顺序重放各块, 得到每块在每个神经元入边中的位置
+        std::vector<std::size_t> cursor(node_count_, 0);
+        for (const NeuronGraph::Block& range : graph.blocks()) {
+            DenseBlock block{range, std::vector<float>(static_cast<std::size_t>(range.to_count) * range.from_count)};
+            for (NeuronGraph::index_type o = 0; o < range.to_count; ++o) {
+                const NeuronGraph::index_type node = range.to_first + o;
+                const float* row = graph.in_weights_data(node) + cursor[node];
+                std::copy(row, row + range.from_count, block.weights.begin() + static_cast<std::ptrdiff_t>(o) * range.from_count);
+                cursor[node] += range.from_count;
+            }
+            blocks_.push_back(std::move(block));
+        }
+    }
+
+public:
+    // graph 必须已经 build; pool 为空时单线程计算
+    template <typename In, typename Out>
+    ForwardPass(const NeuronGraph& graph, In& inputs, Out& outputs, WorkStealingPool* pool = nullptr)
+        : node_count_{graph.node_count()}, inputs_{graph.range_of(inputs)}, outputs_{graph.range_of(outputs)},
+          pool_{pool} {
+        compile(graph);
+    }
+
+    // 从映射的文件构造, 输入输出以 (第一个编号, 个数) 给出
+    ForwardPass(const neuron_file::MappedNeuronGraph& graph,
+                const std::pair<NeuronGraph::index_type, NeuronGraph::index_type> inputs,
+                const std::pair<NeuronGraph::index_type, NeuronGraph::index_type> outputs,
+                WorkStealingPool* pool = nullptr)
+        : node_count_{graph.node_count()}, inputs_{inputs}, outputs_{outputs}, pool_{pool} {
+        if (std::size_t{inputs.first} + inputs.second > node_count_ || std::size_t{outputs.first} + outputs.second > node_count_)
+            throw std::out_of_range("ForwardPass: neuron range out of bounds");
+        compile(graph);
+    }
+
+    [[nodiscard]] std::size_t input_count() const { return inputs_.second; }
+    [[nodiscard]] std::size_t output_count() const { return outputs_.second; }
+
+    // inputs 为 batch x input_count, outputs 为 batch x output_count, 都按样本逐行存放
+    void forward(const float* inputs, const std::size_t batch, float* outputs) {
+        z_.resize(batch * node_count_);
+        a_.resize(batch * node_count_);
+        for (std::size_t b = 0; b < batch; ++b)
+            std::copy(biases_.begin(), biases_.end(), z_.begin() + static_cast<std::ptrdiff_t>(b * node_count_));
+        ready_.assign(node_count_, 0);
+
+        for (std::size_t b = 0; b < batch; ++b)
+            std::copy(inputs + b * inputs_.second, inputs + (b + 1) * inputs_.second,
+                      a_.begin() + static_cast<std::ptrdiff_t>(b * node_count_ + inputs_.first));
+        std::fill(ready_.begin() + inputs_.first, ready_.begin() + inputs_.first + inputs_.second, 1);
+
+        for (const DenseBlock& block : blocks_) {
+            finalize(block.range.from_first, block.range.from_count, batch);
+            accumulate(block, batch);
+        }
+
+        finalize(outputs_.first, outputs_.second, batch);
+        for (std::size_t b = 0; b < batch; ++b)
+            std::copy(a_.begin() + static_cast<std::ptrdiff_t>(b * node_count_ + outputs_.first),
+                      a_.begin() + static_cast<std::ptrdiff_t>(b * node_count_ + outputs_.first + outputs_.second),
+                      outputs + b * outputs_.second);
+    }
+};
+
 // 实现需放在Neuron定义后（因依赖Neuron的迭代器）
 template <typename Self>
 template <typename T>
@@ -49,6 +675,12 @@ void SomeNeurons<Self>::connect_to(T& other) {
     }
 }
 
+template <typename Self>
+template <typename T>
+void SomeNeurons<Self>::connect_to(T& other, NeuronGraph& graph) {
+    graph.connect(*static_cast<Self*>(this), other);
+}
+
 void test() {
     Neuron n1, n2;
     NeuronLayer layer1(3), layer2(4);
@@ -58,3 +690,186 @@ void test() {
     layer1.connect_to(n1);
     layer1.connect_to(layer2);
 }
+
+
+// 两个 2000 个神经元的层全连接 (4M 条边): 逐条 push_back 到各自的 in_ / out_, 对比 NeuronGraph 的批量 CSR,
+// 并比较每条边占用的内存和遍历全部入边的时间
+void benchmark_neuron_graph() {
+    using clock = std::chrono::steady_clock;
+
+    NeuronLayer a(2000), b(2000);
+
+    auto start = clock::now();
+    a.connect_to(b);
+    const auto pointers = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+    std::size_t pointer_bytes = 0;
+    for (auto& n : a)
+        pointer_bytes += (n.in_.capacity() + n.out_.capacity()) * sizeof(Neuron*);
+    for (auto& n : b)
+        pointer_bytes += (n.in_.capacity() + n.out_.capacity()) * sizeof(Neuron*);
+
+    NeuronGraph graph;
+    graph.add(a);
+    graph.add(b);
+    start = clock::now();
+    a.connect_to(b, graph);
+    graph.build();
+    const auto csr = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+    const std::size_t csr_bytes = graph.edge_count() * 2 * sizeof(NeuronGraph::index_type) +
+        (graph.node_count() + 1) * 2 * sizeof(std::size_t);
+
+    start = clock::now();
+    unsigned long long pointer_sum = 0;
+    for (auto& n : b)
+        for (const Neuron* from : n.in_)
+            pointer_sum += from->id_;
+    const auto pointer_walk = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+    start = clock::now();
+    unsigned long long csr_sum = 0;
+    for (NeuronGraph::index_type i = 0; i < graph.node_count(); ++i)
+        for (const NeuronGraph::index_type from : graph.fan_in(i))
+            csr_sum += graph.neuron(from).id_;
+    const auto csr_walk = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+    std::cout << "connect: pointers " << pointers.count() << " us, CSR " << csr.count() << " us; "
+        << "bytes/edge: pointers " << static_cast<double>(pointer_bytes) / graph.edge_count()
+        << ", CSR " << static_cast<double>(csr_bytes) / graph.edge_count() << "; "
+        << "fan-in walk: pointers " << pointer_walk.count() << " us, CSR " << csr_walk.count() << " us"
+        << (pointer_sum == csr_sum ? "" : " (MISMATCH)") << std::endl;
+}
+
+
+// 784-1024-1024-10 的全连接网络: 逐样本和按 64 个一批, 单线程和线程池各跑一遍, 输出每秒推理次数,
+// 并与直接沿 CSR 入边逐条累加的朴素实现核对结果
+void benchmark_forward_pass() {
+    using clock = std::chrono::steady_clock;
+
+    NeuronLayer input(784), hidden1(1024), hidden2(1024), output(10);
+    NeuronGraph graph;
+    graph.add(input);
+    graph.add(hidden1);
+    graph.add(hidden2);
+    graph.add(output);
+    input.connect_to(hidden1, graph);
+    hidden1.connect_to(hidden2, graph);
+    hidden2.connect_to(output, graph);
+    graph.build();
+    graph.set_activation(hidden1, Activation::relu);
+    graph.set_activation(hidden2, Activation::relu);
+    graph.set_activation(output, Activation::sigmoid);
+
+    std::mt19937 rng{5};
+    std::normal_distribution<float> weight{0.0f, 0.05f};
+    for (NeuronGraph::index_type i = 0; i < graph.node_count(); ++i) {
+        graph.set_bias(i, weight(rng));
+        for (float& w : graph.in_weights(i))
+            w = weight(rng);
+    }
+
+    constexpr std::size_t batch = 64;
+    std::uniform_real_distribution<float> pixel{0.0f, 1.0f};
+    std::vector<float> inputs(batch * input.size());
+    for (float& x : inputs)
+        x = pixel(rng);
+
+    // 朴素参照: 逐神经元沿 CSR 入边累加
+    std::vector<float> reference(batch * output.size());
+    for (std::size_t b = 0; b < batch; ++b) {
+        std::vector<float> a(graph.node_count(), 0.0f);
+        std::copy(inputs.begin() + static_cast<std::ptrdiff_t>(b * input.size()),
+                  inputs.begin() + static_cast<std::ptrdiff_t>((b + 1) * input.size()), a.begin());
+        for (auto i = static_cast<NeuronGraph::index_type>(input.size()); i < graph.node_count(); ++i) {
+            float z = graph.bias(i);
+            const float* w = graph.in_weights_data(i);
+            for (const NeuronGraph::index_type from : graph.fan_in(i))
+                z += *w++ * a[from];
+            a[i] = activate(graph.activation(i), z);
+        }
+        std::copy(a.end() - static_cast<std::ptrdiff_t>(output.size()), a.end(),
+                  reference.begin() + static_cast<std::ptrdiff_t>(b * output.size()));
+    }
+
+    WorkStealingPool pool;
+    for (WorkStealingPool* p : {static_cast<WorkStealingPool*>(nullptr), &pool}) {
+        ForwardPass pass{graph, input, output, p};
+        std::vector<float> outputs(batch * output.size());
+        for (const std::size_t b : {std::size_t{1}, batch}) {
+            const int rounds = b == 1 ? 200 : 10;
+            const auto start = clock::now();
+            for (int round = 0; round < rounds; ++round)
+                pass.forward(inputs.data(), b, outputs.data());
+            const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+
+            float max_error = 0.0f;
+            for (std::size_t k = 0; k < b * output.size(); ++k)
+                max_error = std::max(max_error, std::abs(outputs[k] - reference[k]));
+            std::cout << (p ? "pool " : "single ") << "batch " << b << ": "
+                << static_cast<long long>(rounds * b / elapsed) << " inferences/s (max error " << max_error << ")" << std::endl;
+        }
+    }
+}
+
+
+// 四个线程并行创建各层 (检查编号互不重复), 写出文件后映射载入, 比较载入耗时和两边前向传播的结果
+void benchmark_neuron_file() {
+    using clock = std::chrono::steady_clock;
+
+    const int counts[] = {784, 1024, 1024, 10};
+    std::vector<NeuronLayer> layers(4, NeuronLayer{0});
+    {
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < layers.size(); ++i)
+            threads.emplace_back([&, i] { layers[i] = NeuronLayer{counts[i]}; });
+        for (auto& thread : threads)
+            thread.join();
+    }
+    std::unordered_set<unsigned int> ids;
+    std::size_t neuron_count = 0;
+    for (auto& layer : layers) {
+        for (auto& neuron : layer)
+            ids.insert(neuron.id_);
+        neuron_count += layer.size();
+    }
+
+    NeuronGraph graph;
+    for (auto& layer : layers)
+        graph.add(layer);
+    for (std::size_t i = 0; i + 1 < layers.size(); ++i)
+        layers[i].connect_to(layers[i + 1], graph);
+    graph.build();
+    graph.set_activation(layers[1], Activation::relu);
+    graph.set_activation(layers[2], Activation::relu);
+    graph.set_activation(layers[3], Activation::sigmoid);
+    std::mt19937 rng{7};
+    std::normal_distribution<float> weight{0.0f, 0.05f};
+    for (NeuronGraph::index_type i = 0; i < graph.node_count(); ++i) {
+        graph.set_bias(i, weight(rng));
+        for (float& w : graph.in_weights(i))
+            w = weight(rng);
+    }
+
+    auto start = clock::now();
+    neuron_file::save(graph, "network.bin");
+    const auto save = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+    start = clock::now();
+    const neuron_file::MappedNeuronGraph mapped{"network.bin"};
+    const auto load = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+    std::uniform_real_distribution<float> pixel{0.0f, 1.0f};
+    std::vector<float> inputs(784);
+    for (float& x : inputs)
+        x = pixel(rng);
+    std::vector<float> expected(10), actual(10);
+    ForwardPass{graph, layers.front(), layers.back()}.forward(inputs.data(), 1, expected.data());
+    const auto output_first = static_cast<NeuronGraph::index_type>(mapped.node_count() - 10);
+    ForwardPass{mapped, {0, 784}, {output_first, 10}}.forward(inputs.data(), 1, actual.data());
+
+    bool same_ids = true;
+    for (NeuronGraph::index_type i = 0; i < mapped.node_count(); ++i)
+        same_ids = same_ids && mapped.id(i) == graph.neuron(i).id_;
+    std::cout << "unique ids: " << ids.size() << "/" << neuron_count << ", " << mapped.edge_count() << " edges, save "
+        << save.count() << " us, load " << load.count() << " us"
+        << (same_ids && expected == actual ? "" : " (MISMATCH)") << std::endl;
+}
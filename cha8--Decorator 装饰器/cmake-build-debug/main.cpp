@@ -3,12 +3,44 @@
 #include <cstdint>
 #include <memory>
 #include <iostream>
+#include <charconv>
+#include <chrono>
+#include <string_view>
+#include <vector>
 
 using namespace std;
 
+// 由调用方持有的追加缓冲区: 整条装饰链都往同一块内存里写, 清空后容量保留, 可以反复使用
+class Buffer {
+	std::string data_;
+
+public:
+	void clear() { data_.clear(); }
+	void reserve(const std::size_t capacity) { data_.reserve(capacity); }
+
+	Buffer& append(const std::string_view text) {
+		data_.append(text);
+		return *this;
+	}
+
+	// 用 to_chars 格式化, 不经过 locale 和流; general/6 与 ostream 的默认输出相同, fixed/6 与 to_string 相同
+	Buffer& append(const float value, const std::chars_format format, const int precision) {
+		char digits[64]; // fixed 格式下 float 最多 39 位整数部分
+		const auto [last, ec] = std::to_chars(digits, digits + sizeof(digits), value, format, precision);
+		if (ec == std::errc{})
+			data_.append(digits, last);
+		return *this;
+	}
+
+	[[nodiscard]] std::string_view view() const { return data_; }
+	[[nodiscard]] std::size_t size() const { return data_.size(); }
+};
+
 struct Shape {
 	virtual ~Shape() = default;
 	[[nodiscard]] virtual std::string str() const = 0;
+	// 与 str() 的内容相同, 但追加到 out 末尾, 不产生中间字符串
+	virtual void describe(Buffer& out) const = 0;
 	[[nodiscard]] virtual std::unique_ptr<Shape> clone() const = 0;
 };
 
@@ -20,10 +52,6 @@ protected:
 public:
 	explicit Decorator(std::unique_ptr<Shape> component)
 		: component_(std::move(component)) {}
-
-	[[nodiscard]] std::unique_ptr<Shape> clone() const override {
-		return std::make_unique<Decorator>(component_->clone());
-	}
 };
 
 struct Circle : Shape {
@@ -42,6 +70,10 @@ public:
 		oss << "A circle of radius " << radius_;
 		return oss.str();
 	}
+
+	void describe(Buffer& out) const override {
+		out.append("A circle of radius ").append(radius_, std::chars_format::general, 6);
+	}
 };
 
 struct Square : Shape {
@@ -60,6 +92,10 @@ public:
 		oss << "A Square of length: " << length_;
 		return oss.str();
 	}
+
+	void describe(Buffer& out) const override {
+		out.append("A Square of length: ").append(length_, std::chars_format::general, 6);
+	}
 };
 
 class ColoredShape final : public Decorator {
@@ -73,6 +109,11 @@ public:
 		return component_->str() + " with color " + color_;
 	}
 
+	void describe(Buffer& out) const override {
+		component_->describe(out);
+		out.append(" with color ").append(color_);
+	}
+
 	[[nodiscard]] std::unique_ptr<Shape> clone() const override {
 		return std::make_unique<ColoredShape>(component_->clone(), color_);
 	}
@@ -90,11 +131,55 @@ public:
 			std::to_string(static_cast<float>(transparency_) / 255 * 100) + "% transparency";
 	}
 
+	void describe(Buffer& out) const override {
+		component_->describe(out);
+		out.append(" with ").append(static_cast<float>(transparency_) / 255 * 100, std::chars_format::fixed, 6)
+		   .append("% transparency");
+	}
+
 	[[nodiscard]] std::unique_ptr<Shape> clone() const override {
 		return std::make_unique<TransparentShape>(component_->clone(), transparency_);
 	}
 };
 
+// 不同深度的装饰链 (颜色与透明度交替), 逐层拼接的 str() 对比复用同一个 Buffer 的 describe(), 并检查两者输出一致
+void benchmark_describe() {
+	using clock = std::chrono::steady_clock;
+
+	for (const int depth : {1, 4, 16, 64}) {
+		std::unique_ptr<Shape> shape = std::make_unique<Circle>(3.14159f);
+		for (int i = 0; i < depth; ++i) {
+			if (i % 2 == 0)
+				shape = std::make_unique<ColoredShape>(std::move(shape), "red");
+			else
+				shape = std::make_unique<TransparentShape>(std::move(shape), static_cast<uint8_t>(i * 7));
+		}
+
+		const int iterations = 100'000 / depth;
+		std::size_t total = 0;
+		auto start = clock::now();
+		std::string expected;
+		for (int i = 0; i < iterations; ++i) {
+			expected = shape->str();
+			total += expected.size();
+		}
+		const auto nested = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+		Buffer buffer;
+		start = clock::now();
+		for (int i = 0; i < iterations; ++i) {
+			buffer.clear();
+			shape->describe(buffer);
+			total += buffer.size();
+		}
+		const auto appended = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+		std::cout << "depth " << depth << " x " << iterations << ": str() " << nested.count() << " us, describe() "
+			<< appended.count() << " us (" << total / (2 * iterations) << " chars)"
+			<< (buffer.view() == expected ? "" : " (MISMATCH)") << std::endl;
+	}
+}
+
 #include <functional>
 #include <utility>
 #include <string>